@@ -0,0 +1,141 @@
+// Scheduling overhead and scaling of the JobSystem on 1-64 threads.
+// Usage: JobSystemBenchmark [maxThreads] [repetitions]
+// Every number is the median of the repetitions
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+static double NowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+static double Median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static double Measure(int repetitions, const std::function<void()>& run)
+{
+    // Warm up the queues and wake the workers
+    run();
+    std::vector<double> samples;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        double start = NowMs();
+        run();
+        samples.push_back(NowMs() - start);
+    }
+    return Median(samples);
+}
+
+// Empty jobs queued from the main thread, the cost of Run + Execute + Wait
+static const int EMPTY_JOB_COUNT = 100000;
+static void EmptyJobs(JobSystem& jobs)
+{
+    JobCounter counter;
+    for (int i = 0; i < EMPTY_JOB_COUNT; ++i)
+    {
+        jobs.Run([] {}, &counter);
+    }
+    jobs.Wait(counter);
+}
+
+// Every job spawns two more until the leaves, work spreads by stealing only
+static const int SPAWN_DEPTH = 16;
+static void Spawn(JobSystem& jobs, JobCounter& counter, int depth)
+{
+    if (depth == 0) { return; }
+    jobs.Run([&jobs, &counter, depth] { Spawn(jobs, counter, depth - 1); }, &counter);
+    jobs.Run([&jobs, &counter, depth] { Spawn(jobs, counter, depth - 1); }, &counter);
+}
+
+static void SpawnTree(JobSystem& jobs)
+{
+    JobCounter counter;
+    Spawn(jobs, counter, SPAWN_DEPTH);
+    jobs.Wait(counter);
+}
+
+// Each job only runs once the previous one is done, the latency of RunAfter
+static const int CHAIN_LENGTH = 10000;
+static void DependencyChain(JobSystem& jobs)
+{
+    std::vector<JobCounter> counters(CHAIN_LENGTH);
+    jobs.Run([] {}, &counters[0]);
+    for (int i = 1; i < CHAIN_LENGTH; ++i)
+    {
+        jobs.RunAfter(counters[i - 1], [] {}, &counters[i]);
+    }
+    jobs.Wait(counters[CHAIN_LENGTH - 1]);
+}
+
+// Compute bound loop, should scale with the number of cores
+static const size_t PARALLEL_FOR_COUNT = 1 << 22;
+static std::vector<float> parallelForOutput(PARALLEL_FOR_COUNT);
+static void ParallelFor(JobSystem& jobs)
+{
+    jobs.ParallelFor(PARALLEL_FOR_COUNT, 1024, [](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float x = static_cast<float>(i);
+            for (int k = 0; k < 16; ++k)
+            {
+                x = std::sqrt(x + 1.0f) * 1.5f;
+            }
+            parallelForOutput[i] = x;
+        }
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : 64;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    repetitions = std::max(1, repetitions);
+
+    printf("%d hardware threads, median of %d runs\n\n", static_cast<int>(std::thread::hardware_concurrency()), repetitions);
+    printf("%8s %14s %14s %14s %14s %10s %10s\n",
+           "threads", "empty ns/job", "spawn ns/job", "chain ns/link", "parfor ms", "speedup", "stolen %");
+
+    double parallelForBaseline = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem jobs;
+        jobs.Init(threads);
+
+        double emptyMs = Measure(repetitions, [&] { EmptyJobs(jobs); });
+        double spawnMs = Measure(repetitions, [&] { SpawnTree(jobs); });
+        double chainMs = Measure(repetitions, [&] { DependencyChain(jobs); });
+
+        JobSystem::Stats before = jobs.GetStats();
+        double parallelForMs = Measure(repetitions, [&] { ParallelFor(jobs); });
+        JobSystem::Stats after = jobs.GetStats();
+        if (threads == 1) { parallelForBaseline = parallelForMs; }
+
+        size_t run = after.jobsRun - before.jobsRun;
+        size_t stolen = after.jobsStolen - before.jobsStolen;
+        int spawnJobs = (1 << (SPAWN_DEPTH + 1)) - 2;
+
+        printf("%8d %14.1f %14.1f %14.1f %14.2f %9.2fx %9.1f%%\n", threads,
+               emptyMs * 1e6 / EMPTY_JOB_COUNT,
+               spawnMs * 1e6 / spawnJobs,
+               chainMs * 1e6 / CHAIN_LENGTH,
+               parallelForMs,
+               parallelForBaseline / parallelForMs,
+               run > 0 ? 100.0 * stolen / run : 0.0);
+
+        jobs.Shutdown();
+    }
+    return EXIT_SUCCESS;
+}
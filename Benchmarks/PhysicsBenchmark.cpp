@@ -0,0 +1,419 @@
+// PhysicsManager stepping standard stress scenes, without a window or GL,
+// then running batches of scene queries against the settled scene.
+// Usage: PhysicsBenchmark [ticks] [threads] [single|multi] [dbvt|sweep]
+// Prints one JSON object to stdout, so runs can be diffed across commits,
+// thread counts and modes
+// Exits with an error before any output if the PhysicsLod check below fails
+
+#include "PhysicsManager.h"
+#include "SimulationThread.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+JobSystem jobSystem;
+TransformSystem transformSystem;
+
+// ===================================================================
+// Allocation counting. Bullet allocates through btAlignedAlloc, which
+// can be redirected, everything else through operator new
+static std::atomic<size_t> heapAllocations{ 0 };
+static std::atomic<size_t> bulletAllocations{ 0 };
+
+void* operator new(size_t size)
+{
+    ++heapAllocations;
+    if (void* memory = std::malloc(size)) { return memory; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+static void* BulletAlloc(size_t size)
+{
+    ++bulletAllocations;
+    return std::malloc(size);
+}
+
+static void BulletFree(void* memory)
+{
+    std::free(memory);
+}
+
+// ===================================================================
+// Only the transform matters to physics, nothing here is ever drawn
+class BenchmarkObject final : public GlObject
+{
+public:
+    void Draw(const glm::mat4&, glm::vec3) override {}
+    void InitRenderData() override {}
+};
+
+struct Scene
+{
+    const char* name;
+    const char* description;
+    std::function<void(std::vector<GlObject*>&)> build;
+};
+
+static GlObject* AddBox(std::vector<GlObject*>& objects, glm::vec3 position, glm::vec3 halfExtents, bool isStatic)
+{
+    GlObject* object = new BenchmarkObject();
+    object->SetPosition(position);
+    object->SetScale(halfExtents);
+    // PhysicsManager gives every object but the floor a mass, like scene files
+    object->name = isStatic ? "Floor" : "Box";
+    objects.push_back(object);
+    return object;
+}
+
+static void AddGround(std::vector<GlObject*>& objects)
+{
+    AddBox(objects, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(500.0f, 1.0f, 500.0f), true);
+}
+
+// 16 pyramids of 15 rows, stacking keeps the solver busy
+static void BuildPyramids(std::vector<GlObject*>& objects)
+{
+    AddGround(objects);
+    const int ROWS = 15;
+    for (int pyramid = 0; pyramid < 16; ++pyramid)
+    {
+        float offsetX = (pyramid % 4) * 40.0f - 60.0f;
+        float offsetZ = (pyramid / 4) * 40.0f - 60.0f;
+        for (int row = 0; row < ROWS; ++row)
+        {
+            for (int i = 0; i < ROWS - row; ++i)
+            {
+                float x = offsetX + (i - (ROWS - row) * 0.5f) * 1.02f;
+                AddBox(objects, glm::vec3(x, 0.5f + row * 1.0f, offsetZ), glm::vec3(0.5f), false);
+            }
+        }
+    }
+}
+
+// 10k boxes dropped from a grid, broadphase and narrowphase heavy
+static void BuildFallingBoxes(std::vector<GlObject*>& objects)
+{
+    AddGround(objects);
+    for (int i = 0; i < 10000; ++i)
+    {
+        int x = i % 25, z = (i / 25) % 25, y = i / 625;
+        AddBox(objects, glm::vec3(x * 2.5f - 30.0f, 5.0f + y * 2.5f, z * 2.5f - 30.0f), glm::vec3(0.5f), false);
+    }
+}
+
+// 3000 stacks of two resting boxes, far enough apart to be separate
+// islands. They fall asleep early, the cost of a mostly idle world
+static void BuildSleepingIslands(std::vector<GlObject*>& objects)
+{
+    AddGround(objects);
+    for (int i = 0; i < 3000; ++i)
+    {
+        float x = (i % 60) * 4.0f - 120.0f;
+        float z = (i / 60) * 4.0f - 100.0f;
+        AddBox(objects, glm::vec3(x, 0.5f, z), glm::vec3(0.5f), false);
+        AddBox(objects, glm::vec3(x, 1.5f, z), glm::vec3(0.5f), false);
+    }
+}
+
+// 2000 static pillars with 3000 boxes raining between and onto them
+static void BuildMixed(std::vector<GlObject*>& objects)
+{
+    AddGround(objects);
+    for (int i = 0; i < 2000; ++i)
+    {
+        float x = (i % 50) * 3.0f - 75.0f;
+        float z = (i / 50) * 3.0f - 60.0f;
+        AddBox(objects, glm::vec3(x, 2.0f, z), glm::vec3(0.5f, 2.0f, 0.5f), true);
+    }
+    for (int i = 0; i < 3000; ++i)
+    {
+        float x = (i % 50) * 3.0f - 75.0f + 1.5f;
+        float z = ((i / 50) % 40) * 3.0f - 60.0f + 1.5f;
+        float y = 8.0f + (i / 2000) * 3.0f;
+        AddBox(objects, glm::vec3(x, y, z), glm::vec3(0.6f), false);
+    }
+}
+
+// Same queries on every run, so hit counts can be compared
+static unsigned int querySeed = 1;
+static float RandomRange(float low, float high)
+{
+    querySeed = querySeed * 1664525u + 1013904223u;
+    return low + (high - low) * ((querySeed >> 8) / 16777216.0f);
+}
+
+static glm::vec3 RandomPoint(float low, float high)
+{
+    float x = RandomRange(-80.0f, 80.0f);
+    float y = RandomRange(low, high);
+    float z = RandomRange(-80.0f, 80.0f);
+    return glm::vec3(x, y, z);
+}
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Rays and sweeps from above the scene down past the ground, overlaps
+// at random points among the bodies. One frame's worth each
+static void RunQueries(PhysicsManager& physics, size_t count, bool last)
+{
+    querySeed = 1;
+    RaycastBatch rays;
+    SweepBatch sweeps;
+    OverlapBatch overlaps;
+    for (size_t i = 0; i < count; ++i)
+    {
+        rays.from.push_back(RandomPoint(40.0f, 60.0f));
+        rays.to.push_back(RandomPoint(-5.0f, -5.0f));
+        sweeps.from.push_back(RandomPoint(40.0f, 60.0f));
+        sweeps.to.push_back(RandomPoint(-5.0f, -5.0f));
+        sweeps.radius.push_back(0.25f);
+        overlaps.center.push_back(RandomPoint(0.0f, 10.0f));
+        overlaps.radius.push_back(1.0f);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    physics.Raycast(rays);
+    double rayMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    physics.Sweep(sweeps);
+    double sweepMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    physics.Overlap(overlaps);
+    double overlapMs = MsSince(start);
+
+    // Editor picking, one ray at a time
+    double pickMs = 0.0, pickMaxMs = 0.0;
+    const size_t PICKS = 100;
+    for (size_t i = 0; i < PICKS; ++i)
+    {
+        start = std::chrono::steady_clock::now();
+        physics.Pick(rays.from[i], rays.to[i]);
+        double ms = MsSince(start);
+        pickMs += ms;
+        pickMaxMs = std::max(pickMaxMs, ms);
+    }
+
+    size_t rayHits = 0, sweepHits = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        rayHits += rays.results.hit[i];
+        sweepHits += sweeps.results.hit[i];
+    }
+
+    printf("        { \"count\": %zu, \"raycast_ms\": %.3f, \"ray_hits\": %zu, \"sweep_ms\": %.3f, \"sweep_hits\": %zu, "
+           "\"overlap_ms\": %.3f, \"overlapping\": %zu, \"pick_ms\": { \"mean\": %.4f, \"max\": %.4f } }%s\n",
+           count, rayMs, rayHits, sweepMs, sweepHits, overlapMs, overlaps.objects.size(),
+           pickMs / PICKS, pickMaxMs, last ? "" : ",");
+}
+
+// ===================================================================
+// PhysicsLod check. A frozen body that a body of another island runs
+// into during the step is woken and stepped by Bullet, it must come out
+// with the velocity it would have had without LOD, v_before + dv
+// False if LOD was on and the target wasn't frozen, the check would mean nothing
+static bool StepFrozenTarget(bool useLod, btVector3& velocity)
+{
+    btDefaultCollisionConfiguration configuration;
+    btCollisionDispatcher dispatcher(&configuration);
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &configuration);
+    world.setGravity(btVector3(0, 0, 0));
+
+    btBoxShape shape(btVector3(0.5f, 0.5f, 0.5f));
+    btVector3 inertia(0, 0, 0);
+    shape.calculateLocalInertia(1.0f, inertia);
+    std::vector<ObjectMotionState*> moved;
+
+    // The hitter is in the nearest tier, stepped every tick. The target
+    // overlaps it from the second tier, as body 1 it's frozen on tick 0.
+    // It slides sideways so its own velocity shows in the result
+    btTransform start(btQuaternion(0, 0, 0, 1), btVector3(13.8f, 0, 0));
+    ObjectMotionState hitterState(nullptr, start, moved);
+    btRigidBody hitter(btRigidBody::btRigidBodyConstructionInfo(1.0f, &hitterState, &shape, inertia));
+    hitter.setLinearVelocity(btVector3(5.0f, 0, 0));
+    world.addRigidBody(&hitter);
+
+    start.setOrigin(btVector3(14.7f, 0, 0));
+    ObjectMotionState targetState(nullptr, start, moved);
+    btRigidBody target(btRigidBody::btRigidBodyConstructionInfo(1.0f, &targetState, &shape, inertia));
+    target.setLinearVelocity(btVector3(0, 0, 3.0f));
+    world.addRigidBody(&target);
+
+    PhysicsLod lod;
+    PhysicsLodSettings settings;
+    settings.enabled = useLod;
+    settings.tierRadius[0] = 14.2f;
+    lod.SetSettings(settings);
+    lod.SetFocusPoints({ glm::vec3(0.0f) });
+
+    lod.BeginStep(&world, 0);
+    world.stepSimulation(1.0f / 60.0f, 0);
+    lod.EndStep();
+    bool frozen = lod.GetStats().frozenBodies == 1;
+
+    velocity = target.getLinearVelocity();
+    world.removeRigidBody(&target);
+    world.removeRigidBody(&hitter);
+    return !useLod || frozen;
+}
+
+static bool CheckFrozenWake()
+{
+    btVector3 expected, actual;
+    StepFrozenTarget(false, expected);
+    if (!StepFrozenTarget(true, actual))
+    {
+        fprintf(stderr, "ERROR: PhysicsLod check didn't freeze the target\n");
+        return false;
+    }
+    if ((actual - expected).length() > 1e-3f)
+    {
+        fprintf(stderr, "ERROR: Frozen body woken during a step has velocity (%f, %f, %f), expected (%f, %f, %f)\n",
+                actual.getX(), actual.getY(), actual.getZ(), expected.getX(), expected.getY(), expected.getZ());
+        return false;
+    }
+    return true;
+}
+
+static double Percentile(std::vector<double> samples, double fraction)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+int main(int argc, char* argv[])
+{
+    btAlignedAllocSetCustom(BulletAlloc, BulletFree);
+
+    int ticks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 600;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 0;
+    PhysicsSettings settings;
+    settings.threading = (argc > 3 && std::strcmp(argv[3], "multi") == 0) ? PHYSICS_MULTITHREADED : PHYSICS_SINGLE_THREADED;
+    settings.broadphase = (argc > 4 && std::strcmp(argv[4], "sweep") == 0) ? BROADPHASE_AXIS_SWEEP : BROADPHASE_DBVT;
+
+    jobSystem.Init(threads);
+    if (!CheckFrozenWake())
+    {
+        jobSystem.Shutdown();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Scene> scenes =
+    {
+        { "pyramids",         "16 pyramids of 15 rows",            BuildPyramids },
+        { "falling_boxes",    "10000 boxes dropped onto a plane",  BuildFallingBoxes },
+        { "sleeping_islands", "3000 resting two box stacks",       BuildSleepingIslands },
+        { "mixed",            "2000 static pillars, 3000 boxes",   BuildMixed },
+    };
+
+    const float dt = 1.0f / 60.0f;
+    printf("{\n");
+    printf("  \"ticks\": %d,\n", ticks);
+    printf("  \"threads\": %d,\n", jobSystem.GetThreadCount());
+    printf("  \"threading\": \"%s\",\n", settings.threading == PHYSICS_MULTITHREADED ? "multi" : "single");
+    printf("  \"broadphase\": \"%s\",\n", settings.broadphase == BROADPHASE_AXIS_SWEEP ? "sweep" : "dbvt");
+    printf("  \"scenes\": [\n");
+    for (size_t s = 0; s < scenes.size(); ++s)
+    {
+        const Scene& scene = scenes[s];
+
+        size_t heapBefore = heapAllocations;
+        size_t bulletBefore = bulletAllocations;
+
+        PhysicsManager physics;
+        physics.Start(settings);
+        std::vector<GlObject*> objects;
+        scene.build(objects);
+        physics.AddObjects(objects);
+
+        size_t setupHeap = heapAllocations - heapBefore;
+        size_t setupBullet = bulletAllocations - bulletBefore;
+        heapBefore = heapAllocations;
+        bulletBefore = bulletAllocations;
+
+        TransformSnapshot snapshot;
+        snapshot.entries.reserve(objects.size());
+        std::vector<double> stepMs;
+        stepMs.reserve(ticks);
+        double pairSum = 0.0;
+        int maxPairs = 0;
+        size_t movedSum = 0;
+        for (int tick = 1; tick <= ticks; ++tick)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            // Every snapshot is consumed right away
+            physics.Step(dt, tick, tick, snapshot);
+            stepMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            PhysicsStats stats = physics.GetStats();
+            pairSum += stats.overlappingPairs;
+            maxPairs = std::max(maxPairs, stats.overlappingPairs);
+            movedSum += snapshot.entries.size();
+        }
+
+        size_t stepHeap = heapAllocations - heapBefore;
+        size_t stepBullet = bulletAllocations - bulletBefore;
+
+        double mean = 0.0;
+        for (double ms : stepMs) { mean += ms; }
+        mean /= stepMs.size();
+
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", scene.name);
+        printf("      \"description\": \"%s\",\n", scene.description);
+        printf("      \"bodies\": %zu,\n", objects.size());
+        printf("      \"step_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+               mean, Percentile(stepMs, 0.5), Percentile(stepMs, 0.99), Percentile(stepMs, 1.0));
+        printf("      \"pairs\": { \"mean\": %.1f, \"max\": %d },\n", pairSum / ticks, maxPairs);
+        PhysicsStats stats = physics.GetStats();
+        printf("      \"broadphase_filter\": { \"tested\": %llu, \"rejected_by_layer\": %llu, \"rejected_static\": %llu },\n",
+               stats.pairsTested, stats.pairsRejectedByLayer, stats.pairsRejectedStatic);
+        printf("      \"moved_bodies_per_tick\": %.1f,\n", static_cast<double>(movedSum) / ticks);
+        printf("      \"queries\": [\n");
+        RunQueries(physics, 10000, false);
+        RunQueries(physics, 100000, true);
+        printf("      ],\n");
+        printf("      \"allocations\": {\n");
+        printf("        \"setup\": { \"heap\": %zu, \"bullet\": %zu },\n", setupHeap, setupBullet);
+        printf("        \"stepping\": { \"heap\": %zu, \"bullet\": %zu, \"per_tick\": %.2f }\n",
+               stepHeap, stepBullet, static_cast<double>(stepHeap + stepBullet) / ticks);
+        printf("      }\n");
+        printf("    }%s\n", s + 1 < scenes.size() ? "," : "");
+
+        physics.RemoveAll();
+        physics.Shutdown();
+        for (GlObject* object : objects)
+        {
+            delete static_cast<BenchmarkObject*>(object);
+        }
+    }
+    printf("  ]\n");
+    printf("}\n");
+
+    jobSystem.Shutdown();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+// Steps a recorded physics log again without a window or GL, checking
+// every tick against the recorded checksum. Doubles as a benchmark of
+// the recorded situation, e.g. a reported frame spike.
+// Usage: PhysicsReplay <log> [repetitions] [threads]
+// Prints one JSON object to stdout. Tick times are the fastest of all
+// repetitions, the slowest ticks are listed to find the spike to profile
+
+#include "PhysicsManager.h"
+#include "PhysicsRecording.h"
+#include "SimulationThread.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+JobSystem jobSystem;
+TransformSystem transformSystem;
+
+static const int SLOWEST_TICK_COUNT = 10;
+
+// Only gives the motion states something to point at
+class ReplayObject final : public GlObject
+{
+public:
+    void Draw(const glm::mat4&, glm::vec3) override {}
+    void InitRenderData() override {}
+};
+
+struct ReplayResult
+{
+    std::vector<double> tickMs;
+    // First tick whose checksum differed, 0 if none did
+    unsigned long long divergedTick = 0;
+    size_t maxBodies = 0;
+};
+
+static void DeleteObjects(std::vector<GlObject*>& objects)
+{
+    for (GlObject* object : objects)
+    {
+        delete static_cast<ReplayObject*>(object);
+    }
+    objects.clear();
+}
+
+static bool Replay(const char* path, ReplayResult& result)
+{
+    PhysicsLogReader reader;
+    if (!reader.Open(path)) { return false; }
+
+    // Recordings are always single threaded
+    PhysicsSettings settings;
+    settings.threading = PHYSICS_SINGLE_THREADED;
+    settings.broadphase = static_cast<PhysicsBroadphase>(reader.GetBroadphase());
+
+    PhysicsManager physics;
+    physics.Start(settings);
+
+    // Indexed by the ids of the log, null once removed
+    std::vector<GlObject*> objectsById;
+    std::vector<GlObject*> liveObjects;
+    TransformSnapshot snapshot;
+    unsigned long long tick = 0;
+
+    PhysicsLogEntry entry;
+    while (reader.Next(entry))
+    {
+        switch (entry.type)
+        {
+        case PHYSICS_LOG_SPAWN:
+        {
+            std::vector<GlObject*> spawned;
+            spawned.reserve(entry.bodies.size());
+            for (const PhysicsBodyState& state : entry.bodies)
+            {
+                GlObject* object = new ReplayObject();
+                if (objectsById.size() <= state.id) { objectsById.resize(state.id + 1, nullptr); }
+                objectsById[state.id] = object;
+                spawned.push_back(object);
+                liveObjects.push_back(object);
+            }
+            physics.RestoreBodies(spawned, entry.bodies.data(), entry.optimize);
+            result.maxBodies = std::max(result.maxBodies, liveObjects.size());
+            break;
+        }
+        case PHYSICS_LOG_IMPULSE:
+            if (entry.id < objectsById.size() && objectsById[entry.id] != nullptr)
+            {
+                btVector3 impulse;
+                impulse.deSerializeFloat(entry.impulse);
+                physics.ApplyImpulse(objectsById[entry.id], glm::vec3(impulse.getX(), impulse.getY(), impulse.getZ()));
+            }
+            break;
+        case PHYSICS_LOG_REMOVE:
+            if (entry.id < objectsById.size() && objectsById[entry.id] != nullptr)
+            {
+                GlObject* object = objectsById[entry.id];
+                physics.RemoveObject(object);
+                liveObjects.erase(std::find(liveObjects.begin(), liveObjects.end(), object));
+                objectsById[entry.id] = nullptr;
+                delete static_cast<ReplayObject*>(object);
+            }
+            break;
+        case PHYSICS_LOG_REMOVE_ALL:
+            physics.RemoveAll();
+            DeleteObjects(liveObjects);
+            std::fill(objectsById.begin(), objectsById.end(), nullptr);
+            break;
+        case PHYSICS_LOG_STEP:
+        {
+            ++tick;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            physics.Step(entry.dt, tick, tick, snapshot);
+            result.tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            if (result.divergedTick == 0 && physics.GetChecksum() != entry.checksum)
+            {
+                result.divergedTick = tick;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    physics.RemoveAll();
+    physics.Shutdown();
+    DeleteObjects(liveObjects);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: PhysicsReplay <log> [repetitions] [threads]\n");
+        return EXIT_FAILURE;
+    }
+    const char* path = argv[1];
+    int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+    int threads = argc > 3 ? std::atoi(argv[3]) : 0;
+
+    jobSystem.Init(threads);
+
+    std::vector<double> tickMs;
+    unsigned long long divergedTick = 0;
+    size_t maxBodies = 0;
+    for (int r = 0; r < repetitions; ++r)
+    {
+        ReplayResult result;
+        if (!Replay(path, result))
+        {
+            jobSystem.Shutdown();
+            return EXIT_FAILURE;
+        }
+
+        if (r == 0)
+        {
+            tickMs = result.tickMs;
+        }
+        for (size_t i = 0; i < tickMs.size() && i < result.tickMs.size(); ++i)
+        {
+            tickMs[i] = std::min(tickMs[i], result.tickMs[i]);
+        }
+        if (divergedTick == 0) { divergedTick = result.divergedTick; }
+        maxBodies = std::max(maxBodies, result.maxBodies);
+    }
+    jobSystem.Shutdown();
+
+    std::vector<double> sorted = tickMs;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (double ms : tickMs) { mean += ms; }
+    mean = tickMs.empty() ? 0.0 : mean / tickMs.size();
+    double p50 = sorted.empty() ? 0.0 : sorted[(sorted.size() - 1) / 2];
+    double p99 = sorted.empty() ? 0.0 : sorted[static_cast<size_t>((sorted.size() - 1) * 0.99 + 0.5)];
+    double max = sorted.empty() ? 0.0 : sorted.back();
+
+    std::vector<size_t> slowest(tickMs.size());
+    for (size_t i = 0; i < slowest.size(); ++i) { slowest[i] = i; }
+    size_t slowestCount = std::min(slowest.size(), static_cast<size_t>(SLOWEST_TICK_COUNT));
+    std::partial_sort(slowest.begin(), slowest.begin() + slowestCount, slowest.end(),
+                      [&](size_t a, size_t b) { return tickMs[a] > tickMs[b]; });
+
+    printf("{\n");
+    printf("  \"log\": \"%s\",\n", path);
+    printf("  \"repetitions\": %d,\n", repetitions);
+    printf("  \"ticks\": %zu,\n", tickMs.size());
+    printf("  \"max_bodies\": %zu,\n", maxBodies);
+    printf("  \"deterministic\": %s,\n", divergedTick == 0 ? "true" : "false");
+    printf("  \"diverged_tick\": %llu,\n", divergedTick);
+    printf("  \"step_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", mean, p50, p99, max);
+    printf("  \"slowest_ticks\": [");
+    for (size_t i = 0; i < slowestCount; ++i)
+    {
+        printf("%s{ \"tick\": %zu, \"ms\": %.4f }", i == 0 ? " " : ", ", slowest[i] + 1, tickMs[slowest[i]]);
+    }
+    printf(" ]\n");
+    printf("}\n");
+
+    if (divergedTick != 0)
+    {
+        fprintf(stderr, "ERROR: Replay diverged from the recording at tick %llu\n", divergedTick);
+    }
+    return divergedTick == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,13 @@
+#version 450 core
+
+// ==============================================
+in vec4 color;
+
+// ==============================================
+out vec4 fragColor;
+
+// ==============================================
+void main()
+{
+    fragColor = color;
+}
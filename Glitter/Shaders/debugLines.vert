@@ -0,0 +1,22 @@
+#version 450 core
+
+// ==============================================
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+// Bound here, the program keeps it through hot reloads
+layout (std140, binding = 0) uniform Matrices
+{
+    mat4 view;
+    mat4 projection;
+};
+
+// ==============================================
+out vec4 color;
+
+// ==============================================
+void main()
+{
+    color = aColor;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
@@ -0,0 +1,39 @@
+#version 450 core
+
+#include "include/lighting.glsl"
+
+// =========================================
+in vec2 texCoords;
+
+// =========================================
+out vec4 fragColor;
+
+// =========================================
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 invViewProj;
+
+// =========================================
+vec3 WorldPosition(float depth)
+{
+    vec4 ndc = vec4(texCoords * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+    vec4 world = invViewProj * ndc;
+    return world.xyz / world.w;
+}
+
+// =========================================
+// Same lighting as generic.frag, evaluated once per visible pixel
+void main()
+{
+    float depth = texture(gDepth, texCoords).r;
+    // Nothing was written here, keep the clear color
+    if (depth == 1.0f) { discard; }
+
+    vec4 color = texture(gAlbedo, texCoords);
+    vec3 normal = texture(gNormal, texCoords).xyz;
+    vec3 position = WorldPosition(depth);
+
+    fragColor = vec4(Phong(color.rgb, position, normal), color.a);
+}
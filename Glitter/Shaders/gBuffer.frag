@@ -0,0 +1,27 @@
+#version 450 core
+
+// =========================================
+in vec3 position;
+in vec2 uvCoords;
+in vec3 normal;
+
+// =========================================
+// Depth comes from the framebuffer's depth attachment,
+// world position is rebuilt from it in the lighting pass
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec3 gNormal;
+
+// =========================================
+uniform sampler2D texIn;
+
+// =========================================
+void main()
+{
+    vec4 color = texture(texIn, uvCoords);
+#ifdef ALPHA_TEST
+    if (color.a < 0.01) { discard; }
+#endif
+
+    gAlbedo = color;
+    gNormal = normalize(normal);
+}
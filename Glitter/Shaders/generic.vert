@@ -19,6 +19,11 @@ out vec3 normal;
 
 // =========================================
 uniform mat4 model;
+// Inverse transpose of model's 3x3, built with the model matrix
+uniform mat3 normalMatrix;
+
+// Same transform as standard.vert for the depth pre-pass
+invariant gl_Position;
 
 // =========================================
 void main()
@@ -27,6 +32,5 @@ void main()
     position = vec3(model*vec4(aPos, 1.0f));
     uvCoords = aTexCoords;
 
-    // TODO find a way to not do this too often
-    normal = mat3(transpose(inverse(model))) * aNormal;
+    normal = normalMatrix * aNormal;
 }
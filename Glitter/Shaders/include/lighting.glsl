@@ -0,0 +1,35 @@
+// Lighting shared by the forward, deferred and OIT paths
+
+#include "lights.glsl"
+
+// =========================================
+vec3 Phong(vec3 albedo, vec3 position, vec3 normal)
+{
+    vec3 diffuse = vec3(0.0f);
+    vec3 specular = vec3(0.0f);
+
+    // Once per fragment, not per light, so the result
+    // doesn't depend on how many lights there are
+    vec3 totalColor = 0.1f * albedo;
+
+    for (int i = 0; i < numLights; ++i)
+    {
+        vec4 attenFactor = lights[i].attenFactors;
+        float distance = length(lights[i].pos.xyz - position);
+
+        // Outside of the light's sphere its contribution is negligible
+        if (distance > attenFactor.w) { continue; }
+
+        float attenuation = 1.0f / (attenFactor[0] + attenFactor[1]*distance + attenFactor[2]*(distance*distance));
+
+        // Diffuse portion
+        vec3 Li = normalize(lights[i].pos.xyz - position);
+        diffuse = max(0.0f, dot(Li, normal)) * lights[i].color.rgb * attenuation;
+
+        // TODO specular with spec maps
+
+        totalColor += (diffuse + specular) * albedo;
+    }
+
+    return totalColor;
+}
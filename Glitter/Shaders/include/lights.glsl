@@ -0,0 +1,25 @@
+// Light UBO, filled by ObjectManager::UpdateLights
+
+// =========================================
+const int MAX_NUM_LIGHTS = 25;
+
+// =========================================
+struct Light
+{
+    vec4 pos;
+    vec4 color;
+
+    // packed into a vec4
+    //x: constant
+    //y: linear
+    //z: quadratic
+    //w: radius of the light's volume
+    vec4 attenFactors;
+};
+
+// =========================================
+layout (std140, binding = 1) uniform LightBuffer
+{
+    Light lights[MAX_NUM_LIGHTS];
+    uint numLights;
+};
@@ -0,0 +1,21 @@
+// Per-pixel ops fused into the last dispatch of a post-processing
+// chain, the bits are PostProcessChain's POINT_OP_ values
+
+// =========================================
+// bit 0: grayscale
+// bit 1: invert
+uniform uint pointOps;
+
+// =========================================
+vec4 ApplyPointOps(vec4 color)
+{
+    if ((pointOps & 1u) != 0u)
+    {
+        color.rgb = vec3(0.299*color.r + 0.587*color.g + 0.114*color.b);
+    }
+    if ((pointOps & 2u) != 0u)
+    {
+        color.rgb = vec3(1.0f) - color.rgb;
+    }
+    return color;
+}
@@ -0,0 +1,34 @@
+#version 450 core
+
+#include "include/lighting.glsl"
+
+// =========================================
+in vec3 position;
+in vec2 uvCoords;
+in vec3 normal;
+
+// =========================================
+layout (location = 0) out vec4 accum;
+layout (location = 1) out float revealage;
+
+// =========================================
+uniform sampler2D texIn;
+
+// =========================================
+void main()
+{
+    vec4 color = texture(texIn, uvCoords);
+#ifdef ALPHA_TEST
+    if (color.a < 0.01) { discard; }
+#endif
+    vec3 litColor = Phong(color.rgb, position, normal);
+    float alpha = color.a;
+
+    // Weight from McGuire and Bavoil's weighted blended OIT,
+    // favours surfaces that are closer and more opaque
+    float weight = clamp(pow(min(1.0f, alpha * 10.0f) + 0.01f, 3.0f) * 1e8 *
+                         pow(1.0f - gl_FragCoord.z * 0.9f, 3.0f), 1e-2, 3e3);
+
+    accum = vec4(litColor * alpha, alpha) * weight;
+    revealage = alpha;
+}
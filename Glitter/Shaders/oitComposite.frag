@@ -0,0 +1,27 @@
+#version 450 core
+
+in vec2 texCoords;
+
+out vec4 fragColor;
+
+uniform sampler2D accumTex;
+uniform sampler2D revealTex;
+
+void main()
+{
+    float revealage = texture(revealTex, texCoords).r;
+    // No transparent surface covers this pixel
+    if (revealage == 1.0f) { discard; }
+
+    vec4 accum = texture(accumTex, texCoords);
+    // Guard against overflow of the half float accumulation
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b))))
+    {
+        accum.rgb = vec3(accum.a);
+    }
+
+    vec3 averageColor = accum.rgb / max(accum.a, 0.00001f);
+
+    // Blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA over the opaque scene
+    fragColor = vec4(averageColor, 1.0f - revealage);
+}
@@ -1,8 +0,0 @@
-#version 450 core
-
-out vec4 fragColor;
-
-void main()
-{
-    fragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
-}
@@ -1,5 +1,9 @@
 #version 460 core
 
+// Fullscreen post-process fallback for when the compute chain is off.
+// Each effect is a feature define, see ShaderController::GetVariant.
+// With none defined the screen texture is copied as is
+
 in vec2 texCoords;
 
 out vec4 fragColor;
@@ -8,21 +12,38 @@ uniform sampler2D screenTex;
 
 const float offset = 1.0f/300.0f;
 
-// outline kernel
-float outline[9] = float[]
+vec2 offsets[9] = vec2[]
 (
-    -1, -1, -1,
-    -1,  8, -1,
-    -1, -1, -1
+    vec2(-offset,  offset), // top-left
+    vec2( 0.0f,    offset), // top-center
+    vec2( offset,  offset), // top-right
+    vec2(-offset,  0.0f),   // center-left
+    vec2( 0.0f,    0.0f),   // center-center
+    vec2( offset,  0.0f),   // center-right
+    vec2(-offset, -offset), // bottom-left
+    vec2( 0.0f,   -offset), // bottom-center
+    vec2( offset, -offset)  // bottom-right
 );
 
+#ifdef BLUR
 float gaussian[9] = float[]
 (
     1.0/16.0, 1.0/8.0, 1.0/16.0,
     1.0/8.0 , 1.0/4.0, 1.0/8.0 ,
     1.0/16.0, 1.0/8.0, 1.0/16.0
 );
+#endif
+
+#ifdef EDGE_OUTLINE
+float outline[9] = float[]
+(
+    -1, -1, -1,
+    -1,  8, -1,
+    -1, -1, -1
+);
+#endif
 
+#ifdef EDGE_SOBEL
 float sobelX[9] = float[]
 (
     1, 0,-1,
@@ -36,40 +57,50 @@ float sobelY[9] = float[]
     0, 0, 0,
    -1,-2,-1
 );
-
-vec2 offsets[9] = vec2[]
-(
-    vec2(-offset,  offset), // top-left
-    vec2( 0.0f,    offset), // top-center
-    vec2( offset,  offset), // top-right
-    vec2(-offset,  0.0f),   // center-left
-    vec2( 0.0f,    0.0f),   // center-center
-    vec2(-offset,  0.0f),   // center-right
-    vec2(-offset, -offset), // bottom-left
-    vec2( 0.0f,   -offset), // bottom-center
-    vec2( offset, -offset)  // bottom-right
-);
+#endif
 
 void main()
 {
-    vec3 col = vec3(0.0f);
+    vec3 samples[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        samples[i] = texture(screenTex, texCoords + offsets[i]).rgb;
+    }
+
+    vec3 col = samples[4];
 
-    // Pass 1
+#ifdef BLUR
+    col = vec3(0.0f);
     for (int i = 0; i < 9; ++i)
     {
-        col += texture(screenTex, texCoords + offsets[i]).rgb * sobelX[i];
+        col += samples[i] * gaussian[i];
     }
+#endif
 
-    // Pass 2
+#ifdef EDGE_SOBEL
+    vec3 gx = vec3(0.0f);
+    vec3 gy = vec3(0.0f);
+    for (int i = 0; i < 9; ++i)
+    {
+        gx += samples[i] * sobelX[i];
+        gy += samples[i] * sobelY[i];
+    }
+    col = sqrt(gx*gx + gy*gy);
+#elif defined(EDGE_OUTLINE)
+    col = vec3(0.0f);
     for (int i = 0; i < 9; ++i)
     {
-        col += texture(screenTex, texCoords + offsets[i]).rgb * sobelY[i];
+        col += samples[i] * outline[i];
     }
+#endif
 
-    // Gray filter
+#ifdef GRAYSCALE
     col = vec3(0.299*col.r + 0.587*col.g + 0.114*col.b);
+#endif
 
-    col = texture(screenTex, texCoords).rgb;
+#ifdef INVERT
+    col = vec3(1.0f) - col;
+#endif
 
     fragColor = vec4(col, 1.0f);
 }
@@ -2,7 +2,7 @@
 
 layout (location = 0) in vec3 aPos;
 
-layout (std140) uniform Matrices
+layout (std140, binding = 0) uniform Matrices
 {
     mat4 view;
     mat4 projection;
@@ -10,6 +10,10 @@ layout (std140) uniform Matrices
 
 uniform mat4 model;
 
+// Must match generic.vert bit for bit, the depth
+// pre-pass relies on it for GL_EQUAL depth testing
+invariant gl_Position;
+
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
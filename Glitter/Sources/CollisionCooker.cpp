@@ -0,0 +1,403 @@
+#include "CollisionCooker.h"
+
+#include "BulletCollision/CollisionShapes/btShapeHull.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bumped whenever the entry layout changes
+const uint32_t COOKED_MAGIC = 0x4C4F4354; // "TCOL"
+const uint32_t COOKED_VERSION = 1;
+
+// The BVH is Bullet's in-memory layout, it has to start 16 byte aligned
+const uint64_t COOKED_ALIGNMENT = 16;
+
+// Vertices are handed to Bullet as they are in the file
+static_assert(sizeof(btScalar) == sizeof(float), "Cooked collision is stored as floats");
+
+// Followed by the vertices, the indices, the point count of each
+// hull, the hull points and the serialized BVH at the given offsets
+struct CookedHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    float aabbMin[3];
+    float aabbMax[3];
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t hullCount;
+    uint32_t hullPointCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t hullSizeOffset;
+    uint64_t hullPointOffset;
+    uint64_t bvhOffset;
+    uint64_t bvhSize;
+};
+
+// 64-bit FNV-1a
+static unsigned long long Hash(unsigned long long hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t Align(uint64_t offset)
+{
+    return (offset + COOKED_ALIGNMENT - 1) & ~(COOKED_ALIGNMENT - 1);
+}
+
+// Appends the hull of the points, simplified by btShapeHull to the
+// few dozen points that shape it
+static void AddHull(const float* positions, int count, int stride,
+                    std::vector<uint32_t>& hullSizes, std::vector<float>& hullPoints)
+{
+    btConvexHullShape source(positions, count, stride);
+    btShapeHull hull(&source);
+    hull.buildHull(source.getMargin());
+    for (int i = 0; i < hull.numVertices(); ++i)
+    {
+        const btVector3& point = hull.getVertexPointer()[i];
+        hullPoints.push_back(point.getX());
+        hullPoints.push_back(point.getY());
+        hullPoints.push_back(point.getZ());
+    }
+    hullSizes.push_back(static_cast<uint32_t>(hull.numVertices()));
+}
+
+// Private writable mapping, deserializing the BVH patches its header
+// in place. Only the pages written to are copied
+static void* MapFile(const std::string& path, size_t& size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return nullptr; }
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    }
+    CloseHandle(file);
+    if (mapping == NULL) { return nullptr; }
+
+    // The view keeps the mapping alive
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return data;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) { return nullptr; }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        size = static_cast<size_t>(info.st_size);
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    return data == MAP_FAILED ? nullptr : data;
+#endif
+}
+
+static void UnmapFile(void* data, size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+CollisionCooker::~CollisionCooker()
+{
+    Clear();
+}
+
+unsigned long long CollisionCooker::Key(const std::string& sourcePath)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = Hash(hash, sourcePath.c_str(), sourcePath.size() + 1);
+
+    // The serialized BVH is only valid for the Bullet build that wrote it
+    uint32_t layout[] = { COOKED_VERSION, BT_BULLET_VERSION, static_cast<uint32_t>(sizeof(void*)) };
+    hash = Hash(hash, layout, sizeof(layout));
+
+    std::error_code error;
+    unsigned long long size = std::filesystem::file_size(sourcePath, error);
+    if (!error) { hash = Hash(hash, &size, sizeof(size)); }
+    long long time = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    if (!error) { hash = Hash(hash, &time, sizeof(time)); }
+    return hash;
+}
+
+std::string CollisionCooker::EntryPath(unsigned long long key)
+{
+    std::stringstream path;
+    path << COLLISION_CACHE_DIR << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".col";
+    return path.str();
+}
+
+const CookedCollision* CollisionCooker::Get(const std::string& sourcePath, const std::vector<CollisionMeshPart>& parts)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unordered_map<std::string, Entry*>::iterator found = entries.find(sourcePath);
+    if (found != entries.end()) { return &found->second->shapes; }
+
+    unsigned long long key = Key(sourcePath);
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    Entry* entry = Load(key);
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+    if (entry != nullptr)
+    {
+        ++stats.hits;
+        stats.loadMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    else
+    {
+        ++stats.misses;
+        if (!Cook(key, parts)) { return nullptr; }
+
+        // Cooked shapes are loaded from the new entry like any other,
+        // so a model behaves the same on its first and later loads
+        start = std::chrono::high_resolution_clock::now();
+        stats.cookMs += std::chrono::duration<double, std::milli>(start - end).count();
+        entry = Load(key);
+        end = std::chrono::high_resolution_clock::now();
+        stats.loadMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+        if (entry == nullptr)
+        {
+            std::cout << "ERROR: Could not load cooked collision of " << sourcePath << "\n";
+            return nullptr;
+        }
+    }
+
+    entries.emplace(sourcePath, entry);
+    return &entry->shapes;
+}
+
+bool CollisionCooker::Cook(unsigned long long key, const std::vector<CollisionMeshPart>& parts)
+{
+    // Every part in one triangle mesh, indices offset to match
+    std::vector<float> vertices;
+    std::vector<int32_t> indices;
+    for (const CollisionMeshPart& part : parts)
+    {
+        int32_t base = static_cast<int32_t>(vertices.size() / 3);
+        const unsigned char* vertex = reinterpret_cast<const unsigned char*>(part.positions);
+        for (size_t i = 0; i < part.vertexCount; ++i, vertex += part.vertexStride)
+        {
+            const float* position = reinterpret_cast<const float*>(vertex);
+            vertices.insert(vertices.end(), position, position + 3);
+        }
+        for (size_t i = 0; i + 2 < part.indexCount; i += 3)
+        {
+            indices.push_back(base + static_cast<int32_t>(part.indices[i + 0]));
+            indices.push_back(base + static_cast<int32_t>(part.indices[i + 1]));
+            indices.push_back(base + static_cast<int32_t>(part.indices[i + 2]));
+        }
+    }
+    int vertexCount = static_cast<int>(vertices.size() / 3);
+    int triangleCount = static_cast<int>(indices.size() / 3);
+    if (triangleCount == 0) { return false; }
+
+    btTriangleIndexVertexArray mesh(triangleCount, indices.data(), 3 * sizeof(int32_t),
+                                    vertexCount, vertices.data(), 3 * sizeof(float));
+    btBvhTriangleMeshShape triangleMesh(&mesh, true);
+    btOptimizedBvh* bvh = triangleMesh.getOptimizedBvh();
+    unsigned int bvhSize = bvh->calculateSerializeBufferSize();
+    void* bvhData = btAlignedAlloc(bvhSize, COOKED_ALIGNMENT);
+    bvh->serialize(bvhData, bvhSize, false);
+
+    // One hull per mesh. A model built out of convex pieces is
+    // decomposed along its mesh boundaries
+    std::vector<uint32_t> hullSizes;
+    std::vector<float> hullPoints;
+    for (const CollisionMeshPart& part : parts)
+    {
+        if (part.vertexCount < 4) { continue; }
+        AddHull(part.positions, static_cast<int>(part.vertexCount), static_cast<int>(part.vertexStride),
+                hullSizes, hullPoints);
+    }
+    // No mesh was big enough for a hull of its own, use them all
+    if (hullSizes.empty() && vertexCount >= 4)
+    {
+        AddHull(vertices.data(), vertexCount, 3 * sizeof(float), hullSizes, hullPoints);
+    }
+
+    CookedHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = COOKED_MAGIC;
+    header.version = COOKED_VERSION;
+    header.key = key;
+    const btVector3& aabbMin = triangleMesh.getLocalAabbMin();
+    const btVector3& aabbMax = triangleMesh.getLocalAabbMax();
+    header.aabbMin[0] = aabbMin.getX();
+    header.aabbMin[1] = aabbMin.getY();
+    header.aabbMin[2] = aabbMin.getZ();
+    header.aabbMax[0] = aabbMax.getX();
+    header.aabbMax[1] = aabbMax.getY();
+    header.aabbMax[2] = aabbMax.getZ();
+    header.vertexCount = static_cast<uint32_t>(vertexCount);
+    header.triangleCount = static_cast<uint32_t>(triangleCount);
+    header.hullCount = static_cast<uint32_t>(hullSizes.size());
+    header.hullPointCount = static_cast<uint32_t>(hullPoints.size() / 3);
+    header.vertexOffset = Align(sizeof(header));
+    header.indexOffset = Align(header.vertexOffset + vertices.size() * sizeof(float));
+    header.hullSizeOffset = Align(header.indexOffset + indices.size() * sizeof(int32_t));
+    header.hullPointOffset = Align(header.hullSizeOffset + hullSizes.size() * sizeof(uint32_t));
+    header.bvhOffset = Align(header.hullPointOffset + hullPoints.size() * sizeof(float));
+    header.bvhSize = bvhSize;
+
+    std::error_code error;
+    std::filesystem::create_directories(COLLISION_CACHE_DIR, error);
+    if (error)
+    {
+        std::cout << "ERROR: Could not create collision cache folder " << COLLISION_CACHE_DIR << "\n";
+        btAlignedFree(bvhData);
+        return false;
+    }
+
+    // Written next to the entry and renamed, so a crash mid-write
+    // never leaves a truncated entry behind
+    std::string path = EntryPath(key);
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary);
+        uint64_t written = 0;
+        auto write = [&](uint64_t offset, const void* data, size_t size)
+        {
+            static const char padding[COOKED_ALIGNMENT] = {};
+            file.write(padding, static_cast<std::streamsize>(offset - written));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written = offset + size;
+        };
+        write(0, &header, sizeof(header));
+        write(header.vertexOffset, vertices.data(), vertices.size() * sizeof(float));
+        write(header.indexOffset, indices.data(), indices.size() * sizeof(int32_t));
+        write(header.hullSizeOffset, hullSizes.data(), hullSizes.size() * sizeof(uint32_t));
+        write(header.hullPointOffset, hullPoints.data(), hullPoints.size() * sizeof(float));
+        write(header.bvhOffset, bvhData, bvhSize);
+        if (!file)
+        {
+            std::cout << "ERROR: Could not write collision cache entry " << path << "\n";
+        }
+    }
+    btAlignedFree(bvhData);
+    std::filesystem::rename(path + ".tmp", path, error);
+    return !error;
+}
+
+CollisionCooker::Entry* CollisionCooker::Load(unsigned long long key)
+{
+    size_t size = 0;
+    void* data = MapFile(EntryPath(key), size);
+    if (data == nullptr) { return nullptr; }
+
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    CookedHeader header;
+    bool valid = size >= sizeof(header);
+    if (valid)
+    {
+        std::memcpy(&header, bytes, sizeof(header));
+        valid = header.magic == COOKED_MAGIC && header.version == COOKED_VERSION && header.key == key &&
+                header.vertexOffset + header.vertexCount * 3ull * sizeof(float) <= size &&
+                header.indexOffset + header.triangleCount * 3ull * sizeof(int32_t) <= size &&
+                header.hullSizeOffset + header.hullCount * 1ull * sizeof(uint32_t) <= size &&
+                header.hullPointOffset + header.hullPointCount * 3ull * sizeof(float) <= size &&
+                header.bvhOffset % COOKED_ALIGNMENT == 0 && header.bvhOffset + header.bvhSize <= size;
+    }
+    btOptimizedBvh* bvh = nullptr;
+    if (valid)
+    {
+        // Points the BVH's node arrays at the mapping, nothing is copied
+        bvh = static_cast<btOptimizedBvh*>(btOptimizedBvh::deSerializeInPlace(
+            bytes + header.bvhOffset, static_cast<unsigned int>(header.bvhSize), false));
+    }
+    if (bvh == nullptr)
+    {
+        UnmapFile(data, size);
+        return nullptr;
+    }
+
+    Entry* entry = new Entry();
+    entry->mapping = data;
+    entry->mappingSize = size;
+    entry->mesh = new btTriangleIndexVertexArray(
+        static_cast<int>(header.triangleCount), reinterpret_cast<int*>(bytes + header.indexOffset), 3 * sizeof(int32_t),
+        static_cast<int>(header.vertexCount), reinterpret_cast<btScalar*>(bytes + header.vertexOffset), 3 * sizeof(float));
+
+    // With the stored bounds, so the shape doesn't walk every vertex
+    btVector3 aabbMin(header.aabbMin[0], header.aabbMin[1], header.aabbMin[2]);
+    btVector3 aabbMax(header.aabbMax[0], header.aabbMax[1], header.aabbMax[2]);
+    entry->shapes.triangleMesh = new btBvhTriangleMeshShape(entry->mesh, true, aabbMin, aabbMax, false);
+    entry->shapes.triangleMesh->setOptimizedBvh(bvh);
+
+    const uint32_t* hullSizes = reinterpret_cast<const uint32_t*>(bytes + header.hullSizeOffset);
+    const float* hullPoints = reinterpret_cast<const float*>(bytes + header.hullPointOffset);
+    uint32_t pointsLeft = header.hullPointCount;
+    for (uint32_t i = 0; i < header.hullCount && hullSizes[i] <= pointsLeft; ++i)
+    {
+        entry->shapes.hulls.push_back(new btConvexHullShape(hullPoints, static_cast<int>(hullSizes[i]), 3 * sizeof(float)));
+        hullPoints += hullSizes[i] * 3;
+        pointsLeft -= hullSizes[i];
+    }
+    return entry;
+}
+
+void CollisionCooker::Destroy(Entry* entry)
+{
+    for (btConvexHullShape* hull : entry->shapes.hulls)
+    {
+        delete hull;
+    }
+    // The BVH lives in the mapping, the shape doesn't own it
+    delete entry->shapes.triangleMesh;
+    delete entry->mesh;
+    UnmapFile(entry->mapping, entry->mappingSize);
+    delete entry;
+}
+
+CollisionCooker::Stats CollisionCooker::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void CollisionCooker::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::pair<const std::string, Entry*>& entry : entries)
+    {
+        Destroy(entry.second);
+    }
+    entries.clear();
+}
@@ -0,0 +1,92 @@
+#ifndef COLLISION_COOKER_H
+#define COLLISION_COOKER_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Set by CMake to a folder in the build directory
+#ifndef COLLISION_CACHE_DIR
+#define COLLISION_CACHE_DIR "CollisionCache"
+#endif
+
+// Triangles of one mesh of a model, read in place from its vertices
+struct CollisionMeshPart
+{
+    // Each vertex starts with its position as three floats
+    const float* positions = nullptr;
+    size_t vertexCount = 0;
+    // Bytes from one vertex to the next
+    size_t vertexStride = 0;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+};
+
+// Collision shapes cooked from one model file, shared by every
+// object using the model. Owned by the CollisionCooker
+struct CookedCollision
+{
+    // For static bodies. Its triangles and BVH nodes are read straight
+    // from the mapped cache file
+    btBvhTriangleMeshShape* triangleMesh = nullptr;
+    // For dynamic bodies, a reduced convex hull of each mesh
+    std::vector<btConvexHullShape*> hulls;
+};
+
+// Turns model meshes into collision shapes once and keeps the result
+// in an on-disk cache. A cache entry holds the triangles, the hull
+// points and Bullet's quantized BVH serialized in place, so loading
+// it is a file mapping instead of a BVH build. Entries are keyed by
+// the model's path, size and modification time, editing the model
+// misses the cache
+class CollisionCooker
+{
+public:
+    struct Stats
+    {
+        int hits = 0;
+        int misses = 0;
+        // Mapping entries, on hits and right after cooking
+        double loadMs = 0.0;
+        // Building the BVH and hulls and writing the entry on misses
+        double cookMs = 0.0;
+    };
+
+    ~CollisionCooker();
+
+    // Shapes for the model at sourcePath, cooked from parts on a miss.
+    // Models loaded again get the same shapes. Null when the model
+    // has no triangles or its entry can't be mapped
+    const CookedCollision* Get(const std::string& sourcePath, const std::vector<CollisionMeshPart>& parts);
+
+    Stats GetStats();
+
+    // Only once no body or cached shape uses the shapes anymore
+    void Clear();
+
+private:
+    struct Entry
+    {
+        CookedCollision shapes;
+        btTriangleIndexVertexArray* mesh = nullptr;
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+    };
+
+    static unsigned long long Key(const std::string& sourcePath);
+    static std::string EntryPath(unsigned long long key);
+
+    static bool Cook(unsigned long long key, const std::vector<CollisionMeshPart>& parts);
+    // Null if the entry is missing, stale or corrupt
+    static Entry* Load(unsigned long long key);
+    static void Destroy(Entry* entry);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry*> entries;
+    Stats stats;
+};
+
+#endif // COLLISION_COOKER_H
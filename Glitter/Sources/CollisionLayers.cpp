@@ -0,0 +1,70 @@
+#include "CollisionLayers.h"
+
+// ===================================================================
+// CollisionLayers
+CollisionLayers::CollisionLayers()
+{
+    Add("Default");
+}
+
+int CollisionLayers::Find(const std::string& name) const
+{
+    for (int i = 0; i < GetLayerCount(); ++i)
+    {
+        if (names[i] == name) { return i; }
+    }
+    return -1;
+}
+
+int CollisionLayers::Add(const std::string& name)
+{
+    if (GetLayerCount() == MAX_COLLISION_LAYERS) { return -1; }
+
+    int layer = GetLayerCount();
+    names.push_back(name);
+    for (int i = 0; i <= layer; ++i)
+    {
+        SetCollides(layer, i, true);
+    }
+    return layer;
+}
+
+void CollisionLayers::SetCollides(int a, int b, bool collides)
+{
+    // Symmetric, Bullet checks both directions
+    if (collides)
+    {
+        masks[a] |= 1 << b;
+        masks[b] |= 1 << a;
+    }
+    else
+    {
+        masks[a] &= ~(1 << b);
+        masks[b] &= ~(1 << a);
+    }
+}
+
+// ===================================================================
+// CollisionLayerFilter
+bool CollisionLayerFilter::needBroadphaseCollision(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const
+{
+    tested.fetch_add(1, std::memory_order_relaxed);
+
+    if ((proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) == 0 ||
+        (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask) == 0)
+    {
+        rejectedByLayer.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Bullet's default filtering keeps these apart with its static
+    // group, which the layers replace
+    const btCollisionObject* object0 = static_cast<const btCollisionObject*>(proxy0->m_clientObject);
+    const btCollisionObject* object1 = static_cast<const btCollisionObject*>(proxy1->m_clientObject);
+    if (object0->isStaticOrKinematicObject() && object1->isStaticOrKinematicObject())
+    {
+        rejectedStatic.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
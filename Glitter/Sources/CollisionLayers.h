@@ -0,0 +1,62 @@
+#ifndef COLLISION_LAYERS_H
+#define COLLISION_LAYERS_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// One bit per layer in Bullet's collision filter group
+static const int MAX_COLLISION_LAYERS = 16;
+
+// Named layers and which pairs of them collide. A body's proxy gets
+// its layer's bit as filter group and the layer's row of the matrix as
+// filter mask, so Bullet drops pairs of layers that don't collide
+// before they ever reach the narrowphase
+class CollisionLayers
+{
+public:
+    // A single "Default" layer that collides with itself
+    CollisionLayers();
+
+    int GetLayerCount() const { return static_cast<int>(names.size()); }
+    const std::string& GetName(int layer) const { return names[layer]; }
+    // -1 if there is no such layer
+    int Find(const std::string& name) const;
+    // A new layer collides with every layer. -1 once all are used
+    int Add(const std::string& name);
+
+    bool Collides(int a, int b) const { return (masks[a] & (1 << b)) != 0; }
+    void SetCollides(int a, int b, bool collides);
+
+    int GetGroup(int layer) const { return 1 << Clamp(layer); }
+    int GetMask(int layer) const { return masks[Clamp(layer)]; }
+
+private:
+    // Objects can outlive the layer table they were made for
+    int Clamp(int layer) const { return (layer >= 0 && layer < GetLayerCount()) ? layer : 0; }
+
+    std::vector<std::string> names;
+    int masks[MAX_COLLISION_LAYERS] = {};
+};
+
+// Applies the layer masks to new broadphase pairs, and drops pairs
+// of two static bodies, which can never touch. Counts what it sees
+class CollisionLayerFilter : public btOverlapFilterCallback
+{
+public:
+    bool needBroadphaseCollision(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const override;
+
+    unsigned long long GetTestedCount() const { return tested; }
+    unsigned long long GetRejectedByLayerCount() const { return rejectedByLayer; }
+    unsigned long long GetRejectedStaticCount() const { return rejectedStatic; }
+
+private:
+    // Bullet's interface is const
+    mutable std::atomic<unsigned long long> tested{ 0 };
+    mutable std::atomic<unsigned long long> rejectedByLayer{ 0 };
+    mutable std::atomic<unsigned long long> rejectedStatic{ 0 };
+};
+
+#endif // COLLISION_LAYERS_H
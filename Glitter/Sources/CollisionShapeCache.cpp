@@ -0,0 +1,119 @@
+#include "CollisionShapeCache.h"
+
+#include <cmath>
+
+CollisionShapeCache::~CollisionShapeCache()
+{
+    Clear();
+}
+
+long long CollisionShapeCache::Quantize(btScalar value)
+{
+    return std::llround(static_cast<double>(value) * 10000.0);
+}
+
+template <typename Create>
+btCollisionShape* CollisionShapeCache::Get(const Key& key, Create create)
+{
+    std::map<Key, btCollisionShape*>::iterator found = shapes.find(key);
+    if (found != shapes.end())
+    {
+        ++hits;
+        return found->second;
+    }
+
+    btCollisionShape* shape = create();
+    shapes.emplace(key, shape);
+    return shape;
+}
+
+btCollisionShape* CollisionShapeCache::GetBox(const btVector3& halfExtents)
+{
+    Key key(COLLISION_SHAPE_BOX, nullptr,
+            Quantize(halfExtents.getX()), Quantize(halfExtents.getY()), Quantize(halfExtents.getZ()));
+    return Get(key, [&]
+    {
+        btBoxShape* box = new btBoxShape(halfExtents);
+        boxHalfExtents.emplace(box, halfExtents);
+        return box;
+    });
+}
+
+bool CollisionShapeCache::GetBoxHalfExtents(const btCollisionShape* shape, btVector3& halfExtents) const
+{
+    std::map<const btCollisionShape*, btVector3>::const_iterator found = boxHalfExtents.find(shape);
+    if (found == boxHalfExtents.end()) { return false; }
+
+    halfExtents = found->second;
+    return true;
+}
+
+btCollisionShape* CollisionShapeCache::GetSphere(btScalar radius)
+{
+    Key key(COLLISION_SHAPE_SPHERE, nullptr, Quantize(radius), 0, 0);
+    return Get(key, [&] { return new btSphereShape(radius); });
+}
+
+btCollisionShape* CollisionShapeCache::GetUniformScaled(btConvexShape* child, btScalar scale)
+{
+    if (Quantize(scale) == Quantize(1.0f)) { return child; }
+
+    Key key(COLLISION_SHAPE_UNIFORM_SCALED, child, Quantize(scale), 0, 0);
+    return Get(key, [&] { return new btUniformScalingShape(child, scale); });
+}
+
+btCollisionShape* CollisionShapeCache::GetScaledMesh(btBvhTriangleMeshShape* mesh, const btVector3& scale)
+{
+    long long x = Quantize(scale.getX());
+    long long y = Quantize(scale.getY());
+    long long z = Quantize(scale.getZ());
+    long long one = Quantize(1.0f);
+    if (x == one && y == one && z == one) { return mesh; }
+
+    Key key(COLLISION_SHAPE_SCALED_MESH, mesh, x, y, z);
+    return Get(key, [&] { return new btScaledBvhTriangleMeshShape(mesh, scale); });
+}
+
+btCollisionShape* CollisionShapeCache::GetConvexHulls(const std::vector<btConvexHullShape*>& hulls, const btVector3& scale)
+{
+    Key key(COLLISION_SHAPE_CONVEX_HULLS, &hulls,
+            Quantize(scale.getX()), Quantize(scale.getY()), Quantize(scale.getZ()));
+    return Get(key, [&]
+    {
+        std::vector<btCollisionShape*> scaled;
+        for (const btConvexHullShape* hull : hulls)
+        {
+            btConvexHullShape* copy = new btConvexHullShape(
+                reinterpret_cast<const btScalar*>(hull->getUnscaledPoints()), hull->getNumPoints(), sizeof(btVector3));
+            copy->setLocalScaling(scale);
+            scaled.push_back(copy);
+        }
+        if (scaled.size() == 1) { return scaled[0]; }
+
+        btCompoundShape* compound = new btCompoundShape(true, static_cast<int>(scaled.size()));
+        btTransform identity;
+        identity.setIdentity();
+        for (btCollisionShape* child : scaled)
+        {
+            compound->addChildShape(identity, child);
+            compoundChildren.push_back(child);
+        }
+        return static_cast<btCollisionShape*>(compound);
+    });
+}
+
+void CollisionShapeCache::Clear()
+{
+    for (std::pair<const Key, btCollisionShape*>& entry : shapes)
+    {
+        delete entry.second;
+    }
+    shapes.clear();
+    for (btCollisionShape* child : compoundChildren)
+    {
+        delete child;
+    }
+    compoundChildren.clear();
+    boxHalfExtents.clear();
+    hits = 0;
+}
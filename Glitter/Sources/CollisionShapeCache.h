@@ -0,0 +1,71 @@
+#ifndef COLLISION_SHAPE_CACHE_H
+#define COLLISION_SHAPE_CACHE_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+enum CollisionShapeType
+{
+    COLLISION_SHAPE_BOX,
+    COLLISION_SHAPE_SPHERE,
+    COLLISION_SHAPE_UNIFORM_SCALED,
+    COLLISION_SHAPE_SCALED_MESH,
+    COLLISION_SHAPE_CONVEX_HULLS
+};
+
+// Hands out one shared collision shape per shape type and dimensions,
+// so a scene of identical crates keeps a single btBoxShape. Bullet
+// only reads shapes while stepping, any number of bodies can use one.
+// Owns every shape it returned, they live until Clear
+class CollisionShapeCache
+{
+public:
+    ~CollisionShapeCache();
+
+    btCollisionShape* GetBox(const btVector3& halfExtents);
+    btCollisionShape* GetSphere(btScalar radius);
+    // Shares child between every scale through btUniformScalingShape,
+    // for shapes too big to duplicate per size, e.g. convex hulls.
+    // Primitives go through GetBox/GetSphere, the wrapper would cost
+    // them Bullet's box-box and sphere-sphere collision algorithms.
+    // child stays owned by the caller
+    btCollisionShape* GetUniformScaled(btConvexShape* child, btScalar scale);
+    // Static triangle meshes, every scale shares the mesh and its BVH
+    // through btScaledBvhTriangleMeshShape. mesh stays owned by the caller
+    btCollisionShape* GetScaledMesh(btBvhTriangleMeshShape* mesh, const btVector3& scale);
+    // Scaled copies of the hulls, in a compound when there is more
+    // than one. Cooked hulls are reduced to a few dozen points, cheap
+    // enough to copy per scale. hulls stay owned by the caller
+    btCollisionShape* GetConvexHulls(const std::vector<btConvexHullShape*>& hulls, const btVector3& scale);
+
+    // Exact extents a cached box was made with. Bodies asking for
+    // extents within the quantization of them were given the same box
+    bool GetBoxHalfExtents(const btCollisionShape* shape, btVector3& halfExtents) const;
+
+    size_t GetShapeCount() const { return shapes.size(); }
+    // Number of Get calls answered with an existing shape
+    size_t GetHitCount() const { return hits; }
+
+    // Only once no body uses the shapes anymore
+    void Clear();
+
+private:
+    // Dimensions are compared at 1/10000 of a unit, float noise
+    // in scene files shouldn't make a new shape
+    typedef std::tuple<int, const void*, long long, long long, long long> Key;
+    static long long Quantize(btScalar value);
+
+    template <typename Create>
+    btCollisionShape* Get(const Key& key, Create create);
+
+    std::map<Key, btCollisionShape*> shapes;
+    std::map<const btCollisionShape*, btVector3> boxHalfExtents;
+    // Children of the compounds made by GetConvexHulls
+    std::vector<btCollisionShape*> compoundChildren;
+    size_t hits = 0;
+};
+
+#endif // COLLISION_SHAPE_CACHE_H
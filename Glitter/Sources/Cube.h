@@ -19,36 +19,22 @@ public:
         InitRenderData();
     }
 
-    void Draw(glm::vec3 color = glm::vec3(1.0f))
+    void Draw(const glm::mat4& model, glm::vec3 color = glm::vec3(1.0f))
     {
-        if (isActive)
-        {
-            this->shader->use();
+        this->shader->use();
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture.ID);
-            glUniform1i(glGetUniformLocation(this->shader->ID, "texIn"), 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture.ID);
+        glUniform1i(glGetUniformLocation(this->shader->ID, "texIn"), 0);
 
-            glm::mat4 model = glm::mat4(1.0f);
+        glUniformMatrix4fv(glGetUniformLocation(this->shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        // TODO for combining with imguizmo
+        //glUniformMatrix4fv(glGetUniformLocation(this->shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(this->model));
 
-            // TODO translate object back to origin before rotating
-//            model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-//            model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-//            model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-            model = glm::translate(model, position);
-            model = glm::scale(model, scale);
-
-
-            glUniformMatrix4fv(glGetUniformLocation(this->shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            // TODO for combining with imguizmo
-            //glUniformMatrix4fv(glGetUniformLocation(this->shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(this->model));
-
-            // Draw cube
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glBindVertexArray(0);
-        }
+        // Draw cube
+        glBindVertexArray(this->VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
     }
 
 
@@ -133,6 +119,8 @@ public:
 
         // unbinding VAO for later use
         glBindVertexArray(0);
+
+        InitDepthRenderData(vertices, 36, 8);
     }
 
 };
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "ImageLoader.h"
+
 class Cubemap
 {
 public:
@@ -17,24 +19,22 @@ public:
         glGenTextures(1, &ID);
         glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
 
-        int width, height, nrChannels;
-        unsigned char* data;
         for (GLuint i = 0; i < textureFaces.size(); ++i)
         {
-            data = stbi_load(textureFaces[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data)
+            // Possibly decoded ahead of time on a worker thread
+            std::shared_ptr<const ImageData> image = ImageLoader::Get(textureFaces[i]);
+            if (image->pixels)
             {
                 glTexImage2D(
                         GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                        0, GL_RGB, width, height, 0,
-                        GL_RGB, GL_UNSIGNED_BYTE, data
+                        0, GL_RGB, image->width, image->height, 0,
+                        GL_RGB, GL_UNSIGNED_BYTE, image->pixels
                 );
             }
             else
             {
                 std::cout << "ERROR: Cubemap texture failed to load: " << textureFaces[i] << '\n';
             }
-            stbi_image_free(data);
         }
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -0,0 +1,60 @@
+#include "DebugLineRenderer.h"
+
+#include <cstddef>
+
+// Enough for a few thousand boxes before the buffer first grows
+static const size_t INITIAL_CAPACITY = 1 << 20;
+
+void DebugLineRenderer::Init()
+{
+    shader = new Shader("../Glitter/Shaders/debugLines.vert", "../Glitter/Shaders/debugLines.frag");
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    capacity = INITIAL_CAPACITY;
+    glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, position));
+    // RGBA8, read as 0 to 1 floats
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
+    glBindVertexArray(0);
+}
+
+void DebugLineRenderer::Draw(const DebugVertex* vertices, size_t count)
+{
+    lastVertexCount = count;
+    if (count == 0) { return; }
+
+    size_t size = count * sizeof(DebugVertex);
+    while (capacity < size)
+    {
+        capacity *= 2;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // Orphan last frame's storage so the upload doesn't wait for the
+    // GPU to finish drawing from it, then fill the new one in one go
+    glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Over everything, hidden shapes are usually what's being debugged
+    glDisable(GL_DEPTH_TEST);
+    shader->use();
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void DebugLineRenderer::Shutdown()
+{
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+
+    delete shader;
+}
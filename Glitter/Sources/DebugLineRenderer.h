@@ -0,0 +1,32 @@
+#ifndef DEBUG_LINE_RENDERER_H
+#define DEBUG_LINE_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "PhysicsDebugDraw.h"
+
+// Draws a frame's physics debug lines on top of the scene. The lines
+// are uploaded into one streaming vertex buffer and drawn with a
+// single call however many shapes they outline
+class DebugLineRenderer
+{
+public:
+    void Init();
+    // Render thread, with the Matrices UBO holding this frame's camera
+    void Draw(const DebugVertex* vertices, size_t count);
+    void Shutdown();
+
+    Shader* shader;
+
+    // Vertices drawn by the last Draw, for TentGui
+    size_t lastVertexCount = 0;
+
+private:
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    // Bytes of storage in VBO, grows to the largest frame seen
+    size_t capacity = 0;
+};
+
+#endif // DEBUG_LINE_RENDERER_H
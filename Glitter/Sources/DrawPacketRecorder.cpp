@@ -0,0 +1,100 @@
+#include "DrawPacketRecorder.h"
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+void DrawPacketRecorder::Begin()
+{
+    size_t threadCount = std::max(1, jobSystem.GetThreadCount());
+    while (threads.size() < threadCount)
+    {
+        threads.emplace_back(new ThreadPackets());
+    }
+    for (std::unique_ptr<ThreadPackets>& thread : threads)
+    {
+        for (std::vector<DrawPacket>& bucket : thread->buckets)
+        {
+            bucket.clear();
+        }
+    }
+    packetCount = 0;
+}
+
+DrawItem& DrawPacketRecorder::Record(DrawBucket bucket, uint64_t key)
+{
+    // The game thread is 0 when the job system isn't running either
+    int index = std::max(0, JobSystem::ThreadIndex());
+    std::vector<DrawPacket>& packets = threads[index]->buckets[bucket];
+    packets.emplace_back();
+    packets.back().key = key;
+    return packets.back().item;
+}
+
+void DrawPacketRecorder::Merge(RenderCommandBuffer& frame, DrawList lists[DRAW_BUCKET_COUNT])
+{
+    // Each run is sorted on its own first, every thread takes some
+    size_t runCount = threads.size() * DRAW_BUCKET_COUNT;
+    jobSystem.ParallelFor(runCount, 1, [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            std::vector<DrawPacket>& packets = threads[i / DRAW_BUCKET_COUNT]->buckets[i % DRAW_BUCKET_COUNT];
+            std::sort(packets.begin(), packets.end(),
+                [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+        }
+    });
+
+    // Frame memory isn't thread safe, so it's allocated up front
+    packetCount = 0;
+    for (int bucket = 0; bucket < DRAW_BUCKET_COUNT; ++bucket)
+    {
+        size_t count = 0;
+        for (std::unique_ptr<ThreadPackets>& thread : threads)
+        {
+            count += thread->buckets[bucket].size();
+        }
+        lists[bucket].items = frame.AllocateArray<DrawItem>(count);
+        lists[bucket].count = count;
+        packetCount += count;
+    }
+
+    jobSystem.ParallelFor(DRAW_BUCKET_COUNT, 1, [this, lists](size_t begin, size_t end)
+    {
+        for (size_t bucket = begin; bucket < end; ++bucket)
+        {
+            MergeBucket(static_cast<DrawBucket>(bucket), lists[bucket]);
+        }
+    });
+}
+
+void DrawPacketRecorder::MergeBucket(DrawBucket bucket, DrawList& list)
+{
+    // One sorted run per thread, so picking the lowest head
+    // by scanning them is cheaper than a heap
+    std::vector<const DrawPacket*> heads;
+    std::vector<const DrawPacket*> ends;
+    for (std::unique_ptr<ThreadPackets>& thread : threads)
+    {
+        const std::vector<DrawPacket>& packets = thread->buckets[bucket];
+        if (packets.empty()) { continue; }
+        heads.push_back(packets.data());
+        ends.push_back(packets.data() + packets.size());
+    }
+
+    for (size_t out = 0; out < list.count; ++out)
+    {
+        size_t lowest = 0;
+        for (size_t run = 1; run < heads.size(); ++run)
+        {
+            if (heads[run]->key < heads[lowest]->key) { lowest = run; }
+        }
+
+        list.items[out] = heads[lowest]->item;
+        if (++heads[lowest] == ends[lowest])
+        {
+            heads.erase(heads.begin() + lowest);
+            ends.erase(ends.begin() + lowest);
+        }
+    }
+}
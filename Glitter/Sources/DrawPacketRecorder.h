@@ -0,0 +1,86 @@
+#ifndef DRAW_PACKET_RECORDER_H
+#define DRAW_PACKET_RECORDER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RenderCommandBuffer.h"
+
+class GlObject;
+class Shader;
+
+// Everything the render thread needs to draw one object, copied on the
+// game thread while recording so it can keep changing the object
+struct DrawItem
+{
+    GlObject* object;
+    Shader* shader;
+    unsigned int shaderFeatures;
+    // Light color for lights, passed to Draw
+    glm::vec4 color;
+    glm::mat4 model;
+    // From the TransformSystem, so shaders don't invert model per vertex
+    glm::mat3 normalMatrix;
+};
+
+struct DrawList
+{
+    DrawItem* items = nullptr;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    const DrawItem* begin() const { return items; }
+    const DrawItem* end() const { return items + count; }
+};
+
+enum DrawBucket
+{
+    DRAW_BUCKET_OPAQUE,
+    DRAW_BUCKET_ALPHA_TESTED,
+    DRAW_BUCKET_TRANSPARENT,
+    DRAW_BUCKET_LIGHT,
+    DRAW_BUCKET_COUNT
+};
+
+// A draw item and the key it's ordered by, lowest first
+struct DrawPacket
+{
+    uint64_t key;
+    DrawItem item;
+};
+
+// Collects draw packets from every job system thread at once. Each
+// thread appends to its own buckets, which keep their memory between
+// frames, and Merge sorts the per-thread runs in parallel and merges
+// them into one list in the frame's memory for the render thread
+class DrawPacketRecorder
+{
+public:
+    // Game thread, before recording. Clears every thread's buckets
+    void Begin();
+
+    // Any job system thread between Begin and Merge, not threads
+    // outside the pool, which have no buckets of their own
+    DrawItem& Record(DrawBucket bucket, uint64_t key);
+
+    // Game thread, once every job recording packets is done
+    void Merge(RenderCommandBuffer& frame, DrawList lists[DRAW_BUCKET_COUNT]);
+
+    size_t GetPacketCount() const { return packetCount; }
+
+private:
+    struct alignas(64) ThreadPackets
+    {
+        std::vector<DrawPacket> buckets[DRAW_BUCKET_COUNT];
+    };
+
+    void MergeBucket(DrawBucket bucket, DrawList& list);
+
+    std::vector<std::unique_ptr<ThreadPackets>> threads;
+    size_t packetCount = 0;
+};
+
+#endif // DRAW_PACKET_RECORDER_H
@@ -3,6 +3,8 @@
 
 #include "Texture.h"
 
+#include <vector>
+
 enum BufferAttachmentType
 {
     // TODO
@@ -15,12 +17,28 @@ enum BufferAttachmentType
 struct FrameBuffer
 {
     GLuint ID;
-    Texture texture;
+    GLuint rbo = 0; // Depth/stencil renderbuffer, 0 when depth is a texture
+    Texture texture; // First color attachment
+    std::vector<Texture> colorAttachments;
+    Texture depthTexture; // Only valid when created with sampleDepth
     char* name;
+    int width, height;
 
     FrameBuffer(char* _name, int width, int height)
+        : FrameBuffer(_name, width, height, { GL_RGB })
+    {
+    }
+
+    // Creates one texture per entry in colorFormats, attached to
+    // GL_COLOR_ATTACHMENT0 + i (e.g. the G-buffer of the deferred path).
+    // If sampleDepth is set, depth/stencil is stored in a texture
+    // instead of a renderbuffer so later passes can read it
+    FrameBuffer(char* _name, int _width, int _height,
+                std::vector<GLenum> colorFormats, bool sampleDepth = false)
     {
         name = _name;
+        width = _width;
+        height = _height;
         glGenFramebuffers(1, &ID);
         glBindFramebuffer(GL_FRAMEBUFFER, ID);
 
@@ -32,26 +50,60 @@ struct FrameBuffer
         // NOTE: if sampling data then use textures
         // else use renderbuffers
 
-        // Attach a texture to fbo
-        glGenTextures(1, &texture.ID);
-        glBindTexture(GL_TEXTURE_2D, texture.ID);
-        // Texture will be filled when we render to framebuffer
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.ID, 0);
-
-        // Create rbo for depth and stencil
-        GLuint rbo;
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
-        // Attach rbo
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+        std::vector<GLenum> drawBuffers;
+        for (GLuint i = 0; i < colorFormats.size(); ++i)
+        {
+            GLenum format, type;
+            GetTransferFormat(colorFormats[i], format, type);
+
+            // Attach a texture to fbo
+            Texture attachment;
+            attachment.width = width;
+            attachment.height = height;
+            glGenTextures(1, &attachment.ID);
+            glBindTexture(GL_TEXTURE_2D, attachment.ID);
+            // Texture will be filled when we render to framebuffer
+            glTexImage2D(GL_TEXTURE_2D, 0, colorFormats[i], width, height, 0, format, type, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            // Post-processing samples past the edges
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            // Attach texture to framebuffer
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, attachment.ID, 0);
+
+            colorAttachments.push_back(attachment);
+            drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+        }
+        texture = colorAttachments[0];
+        glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+
+        if (sampleDepth)
+        {
+            depthTexture.width = width;
+            depthTexture.height = height;
+            glGenTextures(1, &depthTexture.ID);
+            glBindTexture(GL_TEXTURE_2D, depthTexture.ID);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0,
+                    GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture.ID, 0);
+        }
+        else
+        {
+            // Create rbo for depth and stencil
+            glGenRenderbuffers(1, &rbo);
+            glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            // Attach rbo
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+        }
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         {
@@ -61,6 +113,35 @@ struct FrameBuffer
         // Bind framebuffer if successful
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
+
+    // Replaces this framebuffer's depth/stencil with another framebuffer's
+    // renderbuffer, so a pass can depth test against geometry drawn there
+    void ShareDepth(const FrameBuffer& other)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, ID);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, other.rbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (rbo != 0) { glDeleteRenderbuffers(1, &rbo); }
+        rbo = other.rbo;
+    }
+
+private:
+    // Pixel transfer format/type matching a sized internal format,
+    // only used to allocate the empty attachment storage
+    static void GetTransferFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+    {
+        switch (internalFormat)
+        {
+            case GL_R8:      format = GL_RED;  type = GL_UNSIGNED_BYTE; break;
+            case GL_R16F:    format = GL_RED;  type = GL_FLOAT;         break;
+            case GL_RGB16F:  format = GL_RGB;  type = GL_FLOAT;         break;
+            case GL_RGBA8:   format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+            case GL_RGBA16F: format = GL_RGBA; type = GL_FLOAT;         break;
+            case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT;         break;
+            default:         format = GL_RGB;  type = GL_UNSIGNED_BYTE; break;
+        }
+    }
 };
 
 #endif // FRAME_BUFFER_H
@@ -3,12 +3,19 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
 #include <string>
+#include <vector>
 
 #include "Shader.h"
+#include "ShaderController.h"
 #include "Texture.h"
+#include "TransformSystem.h"
+
+struct CookedCollision;
 
 enum Geometry {
     CUBE,
@@ -23,25 +30,99 @@ enum Geometry {
 class GlObject
 {
 public:
-    virtual void Draw(glm::vec3 color = glm::vec3(1.0f)) = 0;
+    GlObject() : transform(transformSystem.Create()) {}
+    virtual ~GlObject() { transformSystem.Destroy(transform); }
+    // Each object owns its slot in the TransformSystem
+    GlObject(const GlObject&) = delete;
+    GlObject& operator=(const GlObject&) = delete;
+
+    // model is the object's GetDrawMatrix from when the frame was
+    // recorded, the object itself may have moved on since
+    virtual void Draw(const glm::mat4& model, glm::vec3 color = glm::vec3(1.0f)) = 0;
 
     virtual void InitRenderData() = 0;
 
+    // Draws the object with a pass-specific program (e.g. the G-buffer
+    // shader) without changing the shader the object was assigned
+    void DrawWith(Shader* passShader, const glm::mat4& model, glm::vec3 color = glm::vec3(1.0f))
+    {
+        Shader* objectShader = shader;
+        shader = passShader;
+        Draw(model, color);
+        shader = objectShader;
+    }
+
     GLuint VAO;
+    // Tightly packed positions only, so the depth pre-pass
+    // doesn't fetch UVs and normals
+    GLuint depthVAO = 0;
+    GLsizei vertexCount = 0;
     Shader* shader;
     Geometry type = NONE;
 
     std::string name = "unnamed";
-    glm::vec3 position = glm::vec3(0.0f);
-    glm::vec3 scale = glm::vec3(1.0f);
-    glm::vec3 rotation = glm::vec3(0.0f);
 
-    glm::mat4 GetModelMatrix()
+    // The transform lives in the TransformSystem, see there
+    glm::vec3 GetPosition() const { return transformSystem.GetPosition(transform); }
+    glm::quat GetRotation() const { return transformSystem.GetRotation(transform); }
+    glm::vec3 GetScale() const { return transformSystem.GetScale(transform); }
+    void SetPosition(const glm::vec3& position) { transformSystem.SetPosition(transform, position); }
+    void SetRotation(const glm::quat& rotation) { transformSystem.SetRotation(transform, rotation); }
+    void SetScale(const glm::vec3& scale) { transformSystem.SetScale(transform, scale); }
+    // Rotation as Euler angles in degrees, for scene files and editing.
+    // Applied as Rx * Ry * Rz, the order scenes were authored in
+    glm::vec3 GetEulerAngles() const
+    {
+        glm::mat3 rotation = glm::mat3_cast(GetRotation());
+        float sinY = glm::clamp(rotation[2][0], -1.0f, 1.0f);
+        glm::vec3 radians(0.0f, std::asin(sinY), 0.0f);
+        if (std::abs(sinY) < 0.9999f)
+        {
+            radians.x = std::atan2(-rotation[2][1], rotation[2][2]);
+            radians.z = std::atan2(-rotation[1][0], rotation[0][0]);
+        }
+        else
+        {
+            // Gimbal lock, x and z turn about the same axis, put it all in x
+            radians.x = std::atan2(rotation[1][2], rotation[1][1]);
+        }
+        return glm::degrees(radians);
+    }
+    void SetEulerAngles(const glm::vec3& degrees)
     {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, position);
-        model = glm::scale(model, scale);
-        return model;
+        glm::vec3 radians = glm::radians(degrees);
+        SetRotation(glm::angleAxis(radians.x, glm::vec3(1.0f, 0.0f, 0.0f)) *
+                    glm::angleAxis(radians.y, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                    glm::angleAxis(radians.z, glm::vec3(0.0f, 0.0f, 1.0f)));
+    }
+
+    // As of the last TransformSystem::Update, which BuildDrawLists runs
+    const glm::mat4& GetModelMatrix() const { return transformSystem.GetWorldMatrix(transform); }
+    void SetModelMatrix(const glm::mat4& model) { transformSystem.SetMatrix(transform, model); }
+    const glm::mat4& GetNormalMatrix() const { return transformSystem.GetNormalMatrix(transform); }
+
+    // Matrix actually sent to the shader when drawing. The depth pre-pass
+    // and the main pass must use the exact same one, otherwise GL_EQUAL fails
+    virtual glm::mat4 GetDrawMatrix()
+    {
+        return GetModelMatrix();
+    }
+
+    // Depth-only draw for the pre-pass, using the position-only stream
+    virtual void DrawDepth(Shader* depthShader, const glm::mat4& model)
+    {
+        depthShader->setMat4("model", glm::value_ptr(model));
+
+        glBindVertexArray(depthVAO);
+        glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        glBindVertexArray(0);
+    }
+
+    // ShaderFeature bits this object's material needs, used to pick
+    // the specialized variant of whichever shader draws it
+    virtual unsigned int GetShaderFeatures()
+    {
+        return texture.HasAlphaChannel() ? SHADER_FEATURE_ALPHA_TEST : SHADER_FEATURE_NONE;
     }
 
     // TODO should there be a default texture and shader?
@@ -49,6 +130,47 @@ public:
 
     bool isActive = true;
     bool isLight = false;
+    // Transparent objects need blending, so they are always drawn
+    // forward after the opaque geometry
+    bool isTransparent = false;
+    // Index into the PhysicsManager's CollisionLayers
+    int collisionLayer = 0;
+    // Never moved by physics
+    bool isStatic = false;
+    // Shapes cooked from the object's meshes, boxes are used without
+    const CookedCollision* collision = nullptr;
+    // Slot in the TransformSystem
+    const uint32_t transform;
+
+protected:
+    // Builds depthVAO from interleaved vertex data whose
+    // first three floats of each vertex are the position
+    void InitDepthRenderData(const GLfloat* vertices, GLsizei count, int stride)
+    {
+        std::vector<GLfloat> positions;
+        positions.reserve(count * 3);
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            positions.push_back(vertices[i*stride + 0]);
+            positions.push_back(vertices[i*stride + 1]);
+            positions.push_back(vertices[i*stride + 2]);
+        }
+        vertexCount = count;
+
+        glGenVertexArrays(1, &depthVAO);
+        glBindVertexArray(depthVAO);
+
+        GLuint VBO;
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(GLfloat), positions.data(), GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
 };
 
 #endif // GL_OBJECT_H
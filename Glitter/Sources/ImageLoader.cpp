@@ -0,0 +1,62 @@
+#include "ImageLoader.h"
+
+#include "stb_image.h"
+
+std::mutex ImageLoader::mutex;
+std::condition_variable ImageLoader::readyCondition;
+std::unordered_map<std::string, ImageLoader::Entry> ImageLoader::images;
+
+ImageData::~ImageData()
+{
+    if (pixels) { stbi_image_free(pixels); }
+}
+
+std::shared_ptr<const ImageData> ImageLoader::Load(const std::string& path)
+{
+    std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+    image->pixels = stbi_load(path.c_str(), &image->width, &image->height, &image->channels, 0);
+    return image;
+}
+
+bool ImageLoader::Reserve(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.emplace(path, Entry()).second;
+}
+
+void ImageLoader::Decode(const std::string& path)
+{
+    std::shared_ptr<const ImageData> image = Load(path);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = images[path];
+        entry.image = image;
+        entry.ready = true;
+    }
+    readyCondition.notify_all();
+}
+
+std::shared_ptr<const ImageData> ImageLoader::Get(const std::string& path)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = images.find(path);
+        if (it != images.end())
+        {
+            // Elements stay put on rehash, iterators don't
+            Entry* entry = &it->second;
+            readyCondition.wait(lock, [&] { return entry->ready; });
+            return entry->image;
+        }
+    }
+
+    // Never requested, e.g. a texture picked in TentGui
+    return Load(path);
+}
+
+void ImageLoader::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    images.clear();
+}
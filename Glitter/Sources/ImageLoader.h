@@ -0,0 +1,51 @@
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+// Decoded pixels, freed with the last reference
+struct ImageData
+{
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    ~ImageData();
+};
+
+// Lets image decoding happen on worker threads ahead of time while the
+// GL upload stays on the main thread: Reserve + Decode on a worker,
+// then Texture/Cubemap call Get, which waits for the decode if it's
+// still running and decodes inline if it was never requested
+class ImageLoader
+{
+public:
+    // Marks path as being decoded. False if it already was, so
+    // a scene using one texture many times only decodes it once
+    static bool Reserve(const std::string& path);
+    // Thread safe, fills the reserved entry
+    static void Decode(const std::string& path);
+    static std::shared_ptr<const ImageData> Get(const std::string& path);
+    // Drops all decoded images, once everything has been uploaded
+    static void Clear();
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const ImageData> image;
+        bool ready = false;
+    };
+
+    static std::shared_ptr<const ImageData> Load(const std::string& path);
+
+    static std::mutex mutex;
+    static std::condition_variable readyCondition;
+    static std::unordered_map<std::string, Entry> images;
+};
+
+#endif // IMAGE_LOADER_H
@@ -0,0 +1,364 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// Set once per thread by Init/WorkerLoop
+static thread_local int tlsThreadIndex = -1;
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+void JobSystem::Init(int threadCount)
+{
+    if (!queues.empty()) { Shutdown(); }
+
+    if (threadCount <= 0)
+    {
+        // Startup blocks on decodes outside of Wait (see ImageLoader::Get),
+        // which would never run on a single core without a worker
+        threadCount = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    tlsThreadIndex = 0;
+    glThread = std::this_thread::get_id();
+    for (int i = 0; i < threadCount; ++i)
+    {
+        queues.emplace_back(new WorkQueue());
+        queues.back()->stealSeed = 2654435761u * (i + 1);
+    }
+    for (int i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+void JobSystem::Shutdown()
+{
+    if (queues.empty()) { return; }
+
+    // Workers only leave once the queues are empty
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_all();
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    Job job;
+    while (PopGlThread(job) || PopOrSteal(0, job))
+    {
+        Execute(job, 0);
+    }
+
+    queues.clear();
+    stopping = false;
+}
+
+int JobSystem::ThreadIndex()
+{
+    return tlsThreadIndex;
+}
+
+void JobSystem::Run(std::function<void()> work, JobCounter* counter, JobAffinity affinity)
+{
+    if (counter != nullptr) { ++counter->value; }
+
+    Job job;
+    job.work = std::move(work);
+    job.counter = counter;
+    job.affinity = affinity;
+    Push(std::move(job));
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> work,
+                         JobCounter* counter, JobAffinity affinity)
+{
+    if (counter != nullptr) { ++counter->value; }
+
+    Job job;
+    job.work = std::move(work);
+    job.counter = counter;
+    job.affinity = affinity;
+    {
+        // Finish takes the same lock when dependency reaches zero, so the
+        // job is either queued by it or sees zero here
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (dependency.value.load() != 0)
+        {
+            dependency.continuations.push_back(std::move(job));
+            return;
+        }
+    }
+    Push(std::move(job));
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    int index = ThreadIndex();
+    bool isGlThread = std::this_thread::get_id() == glThread.load();
+    while (!counter.IsDone())
+    {
+        Job job;
+        if (isGlThread && PopGlThread(job))
+        {
+            Execute(job, index);
+            continue;
+        }
+        if (index >= 0 && PopOrSteal(index, job))
+        {
+            Execute(job, index);
+            continue;
+        }
+
+        // Nothing to help with, sleep until a job shows up or a counter
+        // is done. Threads outside the pool can only wait
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        ++waitingCount;
+        waitCondition.wait(lock, [&]
+        {
+            return counter.IsDone()
+                || (index >= 0 && queuedJobs.load() > 0)
+                || (isGlThread && queuedGlJobs.load() > 0);
+        });
+        --waitingCount;
+    }
+
+    // The thread that finished the last job may still be holding the
+    // counter, it can only be destroyed once that lock is released
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t minChunk,
+                            const std::function<void(size_t begin, size_t end)>& work)
+{
+    if (count == 0) { return; }
+
+    // A few chunks per thread, fewer if the chunks would get too small
+    size_t threadCount = std::max<size_t>(1, queues.size());
+    size_t chunkTarget = threadCount * 4;
+    size_t chunk = std::max<size_t>(std::max<size_t>(minChunk, 1), (count + chunkTarget - 1) / chunkTarget);
+    if (threadCount == 1 || count <= chunk)
+    {
+        work(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t begin = chunk; begin < count; begin += chunk)
+    {
+        size_t end = std::min(count, begin + chunk);
+        Run([&work, begin, end] { work(begin, end); }, &counter);
+    }
+    // The first chunk is ours, the rest get stolen meanwhile
+    work(0, chunk);
+    Wait(counter);
+}
+
+void JobSystem::BindGlThread()
+{
+    glThread = std::this_thread::get_id();
+}
+
+int JobSystem::RunGlThreadJobs()
+{
+    int count = 0;
+    Job job;
+    // Only what is queued now, GL jobs queuing more run next frame
+    int available = queuedGlJobs.load();
+    for (int i = 0; i < available && PopGlThread(job); ++i)
+    {
+        Execute(job, 0);
+        ++count;
+    }
+    // Queue 0 belongs to the thread that called Init
+    if (workers.empty() && !queues.empty() && ThreadIndex() == 0)
+    {
+        while (PopOrSteal(0, job))
+        {
+            Execute(job, 0);
+            ++count;
+        }
+    }
+    return count;
+}
+
+JobSystem::Stats JobSystem::GetStats()
+{
+    Stats stats;
+    for (const std::unique_ptr<WorkQueue>& queue : queues)
+    {
+        stats.jobsRun += queue->jobsRun.load(std::memory_order_relaxed);
+        stats.jobsStolen += queue->jobsStolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void JobSystem::WorkerLoop(int threadIndex)
+{
+    tlsThreadIndex = threadIndex;
+    while (true)
+    {
+        Job job;
+        bool found = PopOrSteal(threadIndex, job);
+        // New jobs usually follow shortly, sleeping costs more
+        for (int spin = 0; spin < 64 && !found; ++spin)
+        {
+            std::this_thread::yield();
+            found = PopOrSteal(threadIndex, job);
+        }
+        if (found)
+        {
+            Execute(job, threadIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        ++sleepingCount;
+        sleepCondition.wait(lock, [&] { return stopping.load() || queuedJobs.load() > 0; });
+        --sleepingCount;
+        if (stopping.load() && queuedJobs.load() <= 0) { return; }
+    }
+}
+
+void JobSystem::Push(Job job)
+{
+    if (queues.empty())
+    {
+        // Not initialized, behave like a plain function call
+        Execute(job, -1);
+        return;
+    }
+
+    if (job.affinity == JOB_GL_THREAD)
+    {
+        {
+            std::lock_guard<std::mutex> lock(glMutex);
+            glJobs.push_back(std::move(job));
+        }
+        ++queuedGlJobs;
+        WakeWaiters();
+        return;
+    }
+
+    int index = ThreadIndex();
+    if (index < 0)
+    {
+        // Threads outside the pool spread their jobs over the workers
+        index = workers.empty() ? 0 : 1 + nextQueue++ % workers.size();
+    }
+    {
+        WorkQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    ++queuedJobs;
+
+    if (sleepingCount.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+    WakeWaiters();
+}
+
+bool JobSystem::PopOrSteal(int threadIndex, Job& job)
+{
+    WorkQueue& own = *queues[threadIndex];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            --queuedJobs;
+            return true;
+        }
+    }
+
+    // Start at a random victim so thieves don't all pile onto the same one
+    own.stealSeed ^= own.stealSeed << 13;
+    own.stealSeed ^= own.stealSeed >> 17;
+    own.stealSeed ^= own.stealSeed << 5;
+    size_t count = queues.size();
+    size_t start = own.stealSeed % count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t victimIndex = (start + i) % count;
+        if (victimIndex == static_cast<size_t>(threadIndex)) { continue; }
+
+        WorkQueue& victim = *queues[victimIndex];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            --queuedJobs;
+            own.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::PopGlThread(Job& job)
+{
+    std::lock_guard<std::mutex> lock(glMutex);
+    if (glJobs.empty()) { return false; }
+
+    job = std::move(glJobs.front());
+    glJobs.pop_front();
+    --queuedGlJobs;
+    return true;
+}
+
+void JobSystem::Execute(Job& job, int threadIndex)
+{
+    job.work();
+    job.work = nullptr;
+    if (threadIndex >= 0 && threadIndex < static_cast<int>(queues.size()))
+    {
+        queues[threadIndex]->jobsRun.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (job.counter != nullptr)
+    {
+        Finish(*job.counter);
+    }
+}
+
+void JobSystem::Finish(JobCounter& counter)
+{
+    // Lock free unless this might be the last job
+    int value = counter.value.load();
+    while (value > 1)
+    {
+        if (counter.value.compare_exchange_weak(value, value - 1)) { return; }
+    }
+
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        if (counter.value.fetch_sub(1) != 1) { return; }
+        ready.swap(counter.continuations);
+    }
+    // counter may be gone from here on
+    for (Job& job : ready)
+    {
+        Push(std::move(job));
+    }
+    WakeWaiters();
+}
+
+void JobSystem::WakeWaiters()
+{
+    if (waitingCount.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        waitCondition.notify_all();
+    }
+}
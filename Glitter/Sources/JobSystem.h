@@ -0,0 +1,150 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+extern JobSystem jobSystem;
+
+// Counts the jobs that still have to finish before the work it stands for
+// is done. Run/RunAfter increment it, every finished job decrements it.
+// Must outlive its jobs and can't be reused while any are pending
+class JobCounter
+{
+public:
+    JobCounter() {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return value.load() == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> value{ 0 };
+    // Guards the transition to zero and the jobs waiting on it
+    std::mutex mutex;
+    std::vector<Job> continuations;
+};
+
+enum JobAffinity
+{
+    // Any worker, or the main thread while it waits
+    JOB_ANY_THREAD,
+    // Only the thread that owns the GL context, see BindGlThread
+    JOB_GL_THREAD
+};
+
+struct Job
+{
+    std::function<void()> work;
+    JobCounter* counter = nullptr;
+    JobAffinity affinity = JOB_ANY_THREAD;
+};
+
+// Engine wide worker pool. Every thread has its own deque: it pushes and
+// pops at the back (newest first, still in cache) and idle threads steal
+// from the front of the others (oldest, usually the biggest piece of
+// work). Waiting on a counter runs other jobs instead of blocking, so
+// jobs may wait on jobs they spawned
+class JobSystem
+{
+public:
+    struct Stats
+    {
+        size_t jobsRun = 0;
+        size_t jobsStolen = 0;
+    };
+
+    ~JobSystem();
+
+    // threadCount includes the main thread, <= 0 uses one thread per core
+    // but always at least one worker. With 1 there are no workers and
+    // jobs only run while the main thread waits on them, e.g. for serial
+    // benchmarks. Must be called from the main thread
+    void Init(int threadCount = 0);
+    // Waits for the queues to drain and joins the workers
+    void Shutdown();
+
+    // Queues work, counter (if any) is incremented now and decremented
+    // once the work has run
+    void Run(std::function<void()> work, JobCounter* counter = nullptr,
+             JobAffinity affinity = JOB_ANY_THREAD);
+    // Same as Run, but the work is only queued once dependency is done
+    void RunAfter(JobCounter& dependency, std::function<void()> work,
+                  JobCounter* counter = nullptr, JobAffinity affinity = JOB_ANY_THREAD);
+    // Runs jobs until counter is done. Only the GL thread runs
+    // JOB_GL_THREAD jobs, so don't wait on those from a worker
+    void Wait(JobCounter& counter);
+
+    // Calls work(begin, end) over [0, count) split into chunks of at least
+    // minChunk, a few chunks per thread so stealing can even out uneven
+    // work. Small ranges run inline. Returns once every chunk is done
+    void ParallelFor(size_t count, size_t minChunk,
+                     const std::function<void(size_t begin, size_t end)>& work);
+
+    // Makes the calling thread the one JOB_GL_THREAD jobs run on,
+    // the thread calling Init until then
+    void BindGlThread();
+    // Called once per frame by the GL thread, runs the queued GL jobs.
+    // Without workers it runs everything else queued too
+    int RunGlThreadJobs();
+
+    // 0 is the main thread, workers start at 1, -1 for other threads
+    static int ThreadIndex();
+    int GetThreadCount() { return static_cast<int>(queues.size()); }
+    Stats GetStats();
+
+private:
+    // Padded so neighbouring queues don't share a cache line
+    struct alignas(64) WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::atomic<size_t> jobsRun{ 0 };
+        std::atomic<size_t> jobsStolen{ 0 };
+        unsigned int stealSeed = 0;
+    };
+
+    void WorkerLoop(int threadIndex);
+    void Push(Job job);
+    bool PopOrSteal(int threadIndex, Job& job);
+    bool PopGlThread(Job& job);
+    void Execute(Job& job, int threadIndex);
+    void Finish(JobCounter& counter);
+    void WakeWaiters();
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex glMutex;
+    std::deque<Job> glJobs;
+    std::atomic<std::thread::id> glThread;
+
+    // Jobs sitting in a WorkQueue, so sleeping workers know when to wake
+    std::atomic<int> queuedJobs{ 0 };
+    std::atomic<int> queuedGlJobs{ 0 };
+    std::atomic<unsigned int> nextQueue{ 0 };
+
+    std::mutex sleepMutex;
+    // Idle workers
+    std::condition_variable sleepCondition;
+    std::atomic<int> sleepingCount{ 0 };
+    // Threads inside Wait, woken by new jobs and finished counters
+    std::condition_variable waitCondition;
+    std::atomic<int> waitingCount{ 0 };
+
+    std::atomic<bool> stopping{ false };
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,69 @@
+#include "JobTaskScheduler.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "JobSystem.h"
+
+JobTaskScheduler::JobTaskScheduler()
+    : btITaskScheduler("JobSystem")
+{
+    threadCount = getMaxNumThreads();
+}
+
+int JobTaskScheduler::getMaxNumThreads() const
+{
+    // Every pool thread can run chunks, the one that called
+    // JobSystem::Init too while it waits on jobs. The simulation thread
+    // isn't in the pool and runs a share of each loop itself. Bullet
+    // sizes its per thread arrays from this, so none may be left out
+    return std::min(BT_MAX_THREAD_COUNT, jobSystem.GetThreadCount() + 1);
+}
+
+int JobTaskScheduler::getNumThreads() const
+{
+    return threadCount;
+}
+
+void JobTaskScheduler::setNumThreads(int numThreads)
+{
+    threadCount = std::max(1, std::min(numThreads, getMaxNumThreads()));
+}
+
+void JobTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+    if (iEnd <= iBegin) { return; }
+
+    size_t count = static_cast<size_t>(iEnd - iBegin);
+    if (threadCount == 1)
+    {
+        body.forLoop(iBegin, iEnd);
+        return;
+    }
+    jobSystem.ParallelFor(count, std::max(grainSize, 1), [&](size_t begin, size_t end)
+    {
+        body.forLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+    });
+}
+
+btScalar JobTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+{
+    if (iEnd <= iBegin) { return btScalar(0); }
+
+    size_t count = static_cast<size_t>(iEnd - iBegin);
+    if (threadCount == 1)
+    {
+        return body.sumLoop(iBegin, iEnd);
+    }
+
+    // Only a few chunks per thread, a lock per chunk is cheap
+    std::mutex sumMutex;
+    btScalar sum = btScalar(0);
+    jobSystem.ParallelFor(count, std::max(grainSize, 1), [&](size_t begin, size_t end)
+    {
+        btScalar partial = body.sumLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+        std::lock_guard<std::mutex> lock(sumMutex);
+        sum += partial;
+    });
+    return sum;
+}
@@ -0,0 +1,27 @@
+#ifndef JOB_TASK_SCHEDULER_H
+#define JOB_TASK_SCHEDULER_H
+
+#include "LinearMath/btThreads.h"
+
+// Runs Bullet's parallel loops (narrowphase, island solving, ...) on
+// the engine's JobSystem, so physics doesn't start a second thread pool
+// competing with it for the same cores
+class JobTaskScheduler : public btITaskScheduler
+{
+public:
+    JobTaskScheduler();
+
+    int getMaxNumThreads() const override;
+    int getNumThreads() const override;
+    // The JobSystem's size is fixed by Init, this only limits how many
+    // chunks a loop is split into
+    void setNumThreads(int numThreads) override;
+
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+
+private:
+    int threadCount;
+};
+
+#endif // JOB_TASK_SCHEDULER_H
@@ -5,6 +5,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 #include "GlObject.h"
 
 class Light : public GlObject
@@ -17,29 +20,18 @@ public:
         InitRenderData();
     }
 
-    void Draw(glm::vec3 color = glm::vec3(1.0f))
+    // color is the light's color when the frame was recorded
+    void Draw(const glm::mat4& model, glm::vec3 color = glm::vec3(1.0f))
     {
-        if (!isActive) { return; }
-
         this->shader->use();
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture.ID);
 
-        glm::mat4 model = glm::mat4(1.0f);
-
-        // TODO translate object back to origin before rotating
-        //model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        //model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        //model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-        model = glm::translate(model, position);
-        model = glm::scale(model, scale);
-
         glUniformMatrix4fv(glGetUniformLocation(this->shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
         this->shader->use();
-        glUniform3fv(glGetUniformLocation(this->shader->ID, "lightColor"), 1, glm::value_ptr(static_cast<Light*>(this)->color));
+        glUniform3fv(glGetUniformLocation(this->shader->ID, "lightColor"), 1, glm::value_ptr(color));
 
         // Draw cube
         glBindVertexArray(this->VAO);
@@ -114,6 +106,23 @@ public:
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         glBindVertexArray(0);
+
+        InitDepthRenderData(vertices, 36, 8);
+    }
+
+    // Distance at which the light's contribution falls below 5/256,
+    // solved from the attenuation equation. Lights are treated as
+    // spheres of this radius when shading the G-buffer
+    float GetRadius()
+    {
+        float maxChannel = std::max(std::max(color.r, color.g), color.b);
+        if (quadratic <= 0.0f) { return 1000.0f; }
+
+        float c = constant - (256.0f/5.0f) * maxChannel;
+        // Dim lights never reach the cutoff, sqrt would give NaN
+        float discriminant = linear*linear - 4.0f*quadratic*c;
+        if (maxChannel <= 0.0f || discriminant <= 0.0f) { return 0.0f; }
+        return std::max(0.0f, (-linear + std::sqrt(discriminant)) / (2.0f*quadratic));
     }
 
     glm::vec4 color = glm::vec4(1.0f);
@@ -9,7 +9,7 @@ Mesh::Mesh (std::vector<Vertex> v, std::vector<GLuint> i, std::vector<Texture> t
     InitRenderData();
 }
 
-void Mesh::Draw(Shader* shader, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale)
+void Mesh::Draw(Shader* shader, const glm::mat4& model)
 {
     shader->use();
 
@@ -38,16 +38,6 @@ void Mesh::Draw(Shader* shader, glm::vec3 position, glm::vec3 rotation, glm::vec
     }
     glActiveTexture(GL_TEXTURE0);
 
-    glm::mat4 model = glm::mat4(1.0f);
-
-    // TODO translate object back to origin before rotating
-    //model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    //model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    model = glm::translate(model, position);
-    model = glm::scale(model, scale);
-
     glUniformMatrix4fv(glGetUniformLocation(shader->ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
     // draw mesh
@@ -56,6 +46,13 @@ void Mesh::Draw(Shader* shader, glm::vec3 position, glm::vec3 rotation, glm::vec
     glBindVertexArray(0);
 }
 
+void Mesh::DrawDepth()
+{
+    glBindVertexArray(depthVAO);
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
 void Mesh::InitRenderData()
 {
     glGenVertexArrays(1, &VAO);
@@ -80,4 +77,25 @@ void Mesh::InitRenderData()
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
 
     glBindVertexArray(0);
+
+    // Position-only stream for the depth pre-pass, sharing the index buffer
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+    {
+        positions.push_back(vertex.position);
+    }
+
+    glGenVertexArrays(1, &depthVAO);
+    glGenBuffers(1, &depthVBO);
+
+    glBindVertexArray(depthVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, depthVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size()*sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    glBindVertexArray(0);
 }
@@ -23,12 +23,9 @@ class Mesh
 public:
     Mesh(std::vector<Vertex>, std::vector<GLuint>, std::vector<Texture>);
 
-    void Draw(
-        Shader* shader,
-        glm::vec3 position=glm::vec3(0.0f),
-        glm::vec3 rotation=glm::vec3(0.0f),
-        glm::vec3 scale=glm::vec3(1.0f)
-    );
+    void Draw(Shader* shader, const glm::mat4& model);
+    // Positions only, the caller sets the model matrix
+    void DrawDepth();
 
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
@@ -37,6 +34,7 @@ public:
 private:
     void InitRenderData();
     GLuint VAO, VBO, EBO;
+    GLuint depthVAO, depthVBO;
 };
 
 #endif // MESH_H
@@ -13,29 +13,78 @@
 #include "Texture.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "CollisionCooker.h"
 
 class Model : public GlObject
 {
 public:
-    Model (const char* path)
+    Model (const char* _path) : path(_path)
     {
         LoadModel(path);
         InitRenderData();
+
+        for (const Mesh& mesh : meshes)
+        {
+            for (const Texture& meshTexture : mesh.textures)
+            {
+                if (meshTexture.type == "texture_diffuse" && meshTexture.HasAlphaChannel())
+                {
+                    shaderFeatures |= SHADER_FEATURE_ALPHA_TEST;
+                }
+            }
+        }
     }
 
-    void Draw(glm::vec3 color = glm::vec3(1.0f))
+    unsigned int GetShaderFeatures()
     {
-        if (!isActive) { return; }
+        return shaderFeatures;
+    }
 
-        for (Mesh mesh : meshes)
+    void Draw(const glm::mat4& model, glm::vec3 color = glm::vec3(1.0f))
+    {
+        for (Mesh& mesh : meshes)
         {
-            mesh.Draw(this->shader, position, rotation, scale);
+            mesh.Draw(this->shader, model);
+        }
+    }
+
+    void DrawDepth(Shader* depthShader, const glm::mat4& model)
+    {
+        depthShader->setMat4("model", glm::value_ptr(model));
+        for (Mesh& mesh : meshes)
+        {
+            mesh.DrawDepth();
         }
     }
 
     void InitRenderData() {}
 
+    // Triangles of every mesh for PhysicsManager::CookCollision,
+    // pointing into the meshes' vertices
+    std::vector<CollisionMeshPart> GetCollisionParts() const
+    {
+        std::vector<CollisionMeshPart> parts;
+        for (const Mesh& mesh : meshes)
+        {
+            if (mesh.vertices.empty() || mesh.indices.empty()) { continue; }
+
+            CollisionMeshPart part;
+            part.positions = &mesh.vertices[0].position.x;
+            part.vertexCount = mesh.vertices.size();
+            part.vertexStride = sizeof(Vertex);
+            part.indices = mesh.indices.data();
+            part.indexCount = mesh.indices.size();
+            parts.push_back(part);
+        }
+        return parts;
+    }
+
+    // As loaded, scenes save it
+    std::string path;
+
 private:
+    // From the meshes' diffuse textures, they don't change after loading
+    unsigned int shaderFeatures = SHADER_FEATURE_NONE;
     std::vector<Mesh> meshes;
     std::string directory;
     void LoadModel(std::string path);
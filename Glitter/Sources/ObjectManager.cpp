@@ -1,10 +1,14 @@
 #include "ObjectManager.h"
 
 #include <string>
+#include <algorithm>
+#include <cstring>
 #include "ShaderController.h"
 #include "Cube.h"
 #include "Quad.h"
 #include "Light.h"
+#include "JobSystem.h"
+#include "Shared.h"
 
 void ObjectManager::Add(GlObject* object)
 {
@@ -14,8 +18,10 @@ void ObjectManager::Add(GlObject* object)
 void ObjectManager::RemoveObject(int index)
 {
     std::cout << "Removing object at index = " << index << '\n';
-    if (!glObjectList.empty())
+    if (index >= 0 && index < static_cast<int>(glObjectList.size()))
     {
+        // Otherwise its body keeps colliding and moving it
+        shared.physicsManager->RemoveObject(glObjectList[index]);
         glObjectList.erase(glObjectList.begin() + index);
     }
 }
@@ -45,81 +51,193 @@ void ObjectManager::LoadObject(Geometry geom, std::string name, float pos[3], fl
         object->shader = shaderController.Get("generic");
 
     object->texture = tempTex;
-    object->position = glm::make_vec3(pos);
-    object->rotation = glm::make_vec3(rot);
-    object->scale = glm::make_vec3(scale);
+    object->SetPosition(glm::make_vec3(pos));
+    object->SetEulerAngles(glm::make_vec3(rot));
+    object->SetScale(glm::make_vec3(scale));
 
     glObjectList.push_back(object);
+    // Like scene objects, so it collides and can be picked
+    shared.physicsManager->AddObject(object);
 }
 
-void ObjectManager::Draw()
+// Positive floats order the same as their bits
+static uint64_t DistanceKey(float distance2)
 {
-    int i = 0; // For setting light UBO
-    GLuint numLights = 0;
-    for (auto objectPtr: glObjectList)
+    uint32_t bits;
+    std::memcpy(&bits, &distance2, sizeof(bits));
+    return bits;
+}
+
+void ObjectManager::BuildDrawLists(RenderCommandBuffer& frame, const glm::vec3& viewPos,
+                                   bool sortTransparent, FrameDrawLists& lists)
+{
+    // Matrices of whatever moved since the last frame
+    transformSystem.Update();
+
+    packetRecorder.Begin();
+
+    // Keys end with the object's index, so the order doesn't depend
+    // on which thread recorded what
+    jobSystem.ParallelFor(glObjectList.size(), 256, [&](size_t begin, size_t end)
     {
-        if (objectPtr->isLight)
+        for (size_t i = begin; i < end; ++i)
         {
-            Light* light = static_cast<Light*>(objectPtr);
-            numLights++;
-
-            glm::vec4 color = light->color;
-            if (!light->isActive)
+            GlObject* object = glObjectList[i];
+            if (object->isLight)
             {
-                // If light is inactive, set color to 0
-                // this is to overwrite old data stored
-                // within the UBO
-                color = glm::vec4(0.0f);
+                // Inactive lights still need their UBO slot cleared,
+                // they're sorted after the active ones
+                uint64_t key = (object->isActive ? 0ull : 1ull << 63) | i;
+                DrawItem& item = packetRecorder.Record(DRAW_BUCKET_LIGHT, key);
+                item.object = object;
+                item.shader = object->shader;
+                item.shaderFeatures = SHADER_FEATURE_NONE;
+                item.color = static_cast<Light*>(object)->color;
+                item.model = object->GetDrawMatrix();
+                item.normalMatrix = glm::mat3(object->GetNormalMatrix());
+                continue;
             }
+            if (!object->isActive) { continue; }
+
+            glm::vec3 toView = object->GetPosition() - viewPos;
+            uint64_t distance = DistanceKey(glm::dot(toView, toView));
 
-            glBindBuffer(GL_UNIFORM_BUFFER, uboLights);
-
-            // =======================================
-            // Send in light info to light UBO
-            // Position
-            glBufferSubData(GL_UNIFORM_BUFFER,
-                    3*sizeof(glm::vec4)*i,
-                    sizeof(glm::vec4),
-                    glm::value_ptr(light->position));
-
-            // Color
-            glBufferSubData(GL_UNIFORM_BUFFER,
-                    3*sizeof(glm::vec4)*i + sizeof(glm::vec4),
-                    sizeof(glm::vec4),
-                    glm::value_ptr(color));
-
-            // Attenuation factors
-            glm::vec4 attenuation =
-                glm::vec4(
-                    light->constant,
-                    light->linear,
-                    light->quadratic,
-                    0.0f // padding
-                );
-
-            glBufferSubData(GL_UNIFORM_BUFFER,
-                    3*sizeof(glm::vec4)*i + 2*sizeof(glm::vec4),
-                    sizeof(glm::vec4),
-                    glm::value_ptr(attenuation));
-            // =======================================
-
-            glBindBuffer(GL_UNIFORM_BUFFER, 0);
-            glBindBufferBase(GL_UNIFORM_BUFFER, 1, uboLights);
-
-            ++i;
+            // Opaque front to back so that early-Z rejects hidden fragments,
+            // transparent back to front for correct blending
+            unsigned int features = object->GetShaderFeatures();
+            DrawItem* item;
+            if (object->isTransparent)
+            {
+                uint64_t key = sortTransparent ? ((0xFFFFFFFFull - distance) << 32) | i : i;
+                item = &packetRecorder.Record(DRAW_BUCKET_TRANSPARENT, key);
+            }
+            else
+            {
+                DrawBucket bucket = (features & SHADER_FEATURE_ALPHA_TEST) ? DRAW_BUCKET_ALPHA_TESTED : DRAW_BUCKET_OPAQUE;
+                item = &packetRecorder.Record(bucket, (distance << 32) | i);
+            }
+            item->object = object;
+            item->shader = object->shader;
+            item->shaderFeatures = features;
+            item->color = glm::vec4(1.0f);
+            item->model = object->GetDrawMatrix();
+            item->normalMatrix = glm::mat3(object->GetNormalMatrix());
         }
+    });
+
+    DrawList merged[DRAW_BUCKET_COUNT];
+    packetRecorder.Merge(frame, merged);
+    lists.opaque = merged[DRAW_BUCKET_OPAQUE];
+    lists.alphaTested = merged[DRAW_BUCKET_ALPHA_TESTED];
+    lists.transparent = merged[DRAW_BUCKET_TRANSPARENT];
+    lists.lights = merged[DRAW_BUCKET_LIGHT];
+
+    // Inactive lights are uploaded black to overwrite their old slot
+    lists.lightData = frame.AllocateArray<LightData>(maxNumLights);
+    lists.lightCount = 0;
+    for (const DrawItem& item : lists.lights)
+    {
+        if (lists.lightCount == maxNumLights) { break; }
+
+        Light* light = static_cast<Light*>(item.object);
+        LightData& data = lists.lightData[lists.lightCount++];
+        data.position = glm::vec4(light->GetPosition(), 1.0f);
+        data.color = light->isActive ? light->color : glm::vec4(0.0f);
+        data.attenuation = glm::vec4(
+            light->constant,
+            light->linear,
+            light->quadratic,
+            light->GetRadius() // Used by the deferred pass to skip far lights
+        );
+    }
 
-        objectPtr->Draw();
+    // Only the active lights at the front are drawn
+    size_t activeLights = 0;
+    while (activeLights < lists.lights.count && lists.lights.items[activeLights].object->isActive)
+    {
+        ++activeLights;
     }
+    lists.lights.count = activeLights;
+}
+
+void ObjectManager::UpdateLights(const FrameDrawLists& lists)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, uboLights);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, lists.lightCount * sizeof(LightData), lists.lightData);
+
     // Send number of lights to light UBO
     // TODO replace light UBO with SSBO, since that can store much
     // more data than UBO
-    //std::cout << "Number of lights in scene " << numLights << '\n';
-    glBindBuffer(GL_UNIFORM_BUFFER, uboLights);
     glBufferSubData(GL_UNIFORM_BUFFER,
-            maxNumLights*3*sizeof(glm::vec4),
+            maxNumLights*sizeof(LightData),
             sizeof(GLuint),
-            &numLights);
+            &lists.lightCount);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
     glBindBufferBase(GL_UNIFORM_BUFFER, 1, uboLights);
 }
+
+// glProgramUniform, Draw binds the program itself. Shaders without
+// normals don't have the uniform and ignore it
+static void SetNormalMatrix(Shader* shader, const glm::mat3& normalMatrix)
+{
+    glProgramUniformMatrix3fv(shader->ID, glGetUniformLocation(shader->ID, "normalMatrix"),
+                              1, GL_FALSE, glm::value_ptr(normalMatrix));
+}
+
+void ObjectManager::DrawDepth(const DrawList& list, Shader* depthShader)
+{
+    for (const DrawItem& item : list)
+    {
+        item.object->DrawDepth(depthShader, item.model);
+    }
+}
+
+void ObjectManager::DrawOpaque(const DrawList& list, Shader* passShader)
+{
+    // Nothing opaque needs blending
+    glDisable(GL_BLEND);
+    for (const DrawItem& item : list)
+    {
+        Shader* baseShader = passShader ? passShader : item.shader;
+        Shader* shader = shaderController.GetVariant(baseShader, item.shaderFeatures);
+        SetNormalMatrix(shader, item.normalMatrix);
+        item.object->DrawWith(shader, item.model);
+    }
+}
+
+void ObjectManager::DrawLights(const DrawList& list)
+{
+    glDisable(GL_BLEND);
+    for (const DrawItem& item : list)
+    {
+        item.object->DrawWith(item.shader, item.model, glm::vec3(item.color));
+    }
+}
+
+void ObjectManager::DrawTransparent(const DrawList& list)
+{
+    if (list.empty()) { return; }
+
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+    for (const DrawItem& item : list)
+    {
+        Shader* shader = shaderController.GetVariant(item.shader, item.shaderFeatures);
+        SetNormalMatrix(shader, item.normalMatrix);
+        item.object->DrawWith(shader, item.model);
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+void ObjectManager::DrawTransparentAccum(const DrawList& list, Shader* accumShader)
+{
+    // Blend state is set by the caller, the result
+    // doesn't depend on the order objects are drawn in
+    for (const DrawItem& item : list)
+    {
+        Shader* shader = shaderController.GetVariant(accumShader, item.shaderFeatures);
+        SetNormalMatrix(shader, item.normalMatrix);
+        item.object->DrawWith(shader, item.model);
+    }
+}
@@ -4,6 +4,30 @@
 #include <vector>
 
 #include "Object.h"
+#include "RenderCommandBuffer.h"
+#include "DrawPacketRecorder.h"
+
+// One light in the LightBuffer UBO, see include/lights.glsl
+struct LightData
+{
+    glm::vec4 position;
+    glm::vec4 color;
+    // constant, linear, quadratic, radius
+    glm::vec4 attenuation;
+};
+
+// Draw lists of one frame, in the frame's command buffer memory
+struct FrameDrawLists
+{
+    DrawList opaque;
+    // Opaque but with cutouts. Kept out of the depth pre-pass, its
+    // shader can't discard, so they're drawn after the other opaques
+    DrawList alphaTested;
+    DrawList transparent;
+    DrawList lights;
+    LightData* lightData = nullptr;
+    GLuint lightCount = 0;
+};
 
 class ObjectManager
 {
@@ -21,10 +45,31 @@ public:
     void Add(Object* object);
     void LoadObject(Geometry geom, std::string name, float pos[3], float rot[3], float scale[3]);
     void RemoveObject(int index);
-    void Draw();
+    // Game thread. Splits active objects into opaque and alpha tested
+    // (front to back), transparent (back to front) and light lists in
+    // the frame's memory,
+    // for the draw functions below, along with the light UBO contents.
+    // Objects are prepared on every job system thread at once. OIT
+    // doesn't need the transparent sort, so it can be skipped
+    void BuildDrawLists(RenderCommandBuffer& frame, const glm::vec3& viewPos,
+                        bool sortTransparent, FrameDrawLists& lists);
+
+    // Render thread, drawing what BuildDrawLists recorded
+    void UpdateLights(const FrameDrawLists& lists);
+    // Depth pre-pass over opaque objects
+    void DrawDepth(const DrawList& list, Shader* depthShader);
+    // Opaque objects with their own shader, or through a pass
+    // shader (e.g. the G-buffer) when one is given
+    void DrawOpaque(const DrawList& list, Shader* passShader = nullptr);
+    void DrawLights(const DrawList& list);
+    // Transparent objects blended in sorted order
+    void DrawTransparent(const DrawList& list);
+    // Transparent objects into the OIT accumulation/revealage targets
+    void DrawTransparentAccum(const DrawList& list, Shader* accumShader);
 
     std::vector<Object*> objectList;
     std::vector<GlObject*> glObjectList;
+    DrawPacketRecorder packetRecorder;
     // TODO better way to do this with UBOs?
     // Maybe inside a resource manager?
     GLuint uboLights;
@@ -0,0 +1,58 @@
+#ifndef OBJECT_MOTION_STATE_H
+#define OBJECT_MOTION_STATE_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <vector>
+
+class GlObject;
+
+// Transform slot of one object's rigid body. Bullet only calls
+// setWorldTransform for bodies that moved while awake, so sleeping and
+// static bodies are never visited. The first call of a step marks the
+// slot dirty and queues it, PhysicsManager::Step then only reads the
+// queued slots instead of walking every collision object
+class ObjectMotionState : public btMotionState
+{
+public:
+    ObjectMotionState(GlObject* _object, const btTransform& start, std::vector<ObjectMotionState*>& _moved)
+        : object(_object), transform(start), previousTransform(start), moved(_moved)
+    {
+    }
+
+    void getWorldTransform(btTransform& worldTrans) const override
+    {
+        worldTrans = transform;
+    }
+
+    void setWorldTransform(const btTransform& worldTrans) override
+    {
+        if (!dirty)
+        {
+            previousTransform = transform;
+            dirty = true;
+            moved.push_back(this);
+        }
+        transform = worldTrans;
+    }
+
+    GlObject* object;
+    btTransform transform;
+    // Where the body was before the step that dirtied it
+    btTransform previousTransform;
+    // Set by setWorldTransform, cleared once the step is done
+    bool dirty = false;
+
+    // Last tick the body moved in. It stays in the snapshots until the
+    // reader has seen one with its final transform
+    unsigned long long movedTick = 0;
+    bool isRecent = false;
+
+    // Put to sleep by PhysicsLod for being far from every focus point
+    bool lodAsleep = false;
+
+private:
+    std::vector<ObjectMotionState*>& moved;
+};
+
+#endif // OBJECT_MOTION_STATE_H
@@ -0,0 +1,79 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed size slots for one type, allocated a chunk at a time and reused
+// through a free list, so creating many objects of the same type (e.g.
+// the rigid bodies of a scene) costs one allocation per chunk. Slots
+// are aligned for T, which Bullet's SIMD types need
+template <typename T, size_t CHUNK_SIZE = 256>
+class ObjectPool
+{
+public:
+    ObjectPool() {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Objects still alive aren't destructed, Destroy them first
+    ~ObjectPool()
+    {
+        for (Slot* chunk : chunks)
+        {
+            ::operator delete(chunk, std::align_val_t(alignof(Slot)));
+        }
+    }
+
+    template <typename... Args>
+    T* Create(Args&&... args)
+    {
+        if (freeList == nullptr) { Grow(); }
+
+        Slot* slot = freeList;
+        freeList = slot->next;
+        ++liveCount;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void Destroy(T* object)
+    {
+        if (object == nullptr) { return; }
+
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = freeList;
+        freeList = slot;
+        --liveCount;
+    }
+
+    size_t GetLiveCount() const { return liveCount; }
+    size_t GetChunkCount() const { return chunks.size(); }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void Grow()
+    {
+        Slot* chunk = static_cast<Slot*>(::operator new(sizeof(Slot) * CHUNK_SIZE, std::align_val_t(alignof(Slot))));
+        chunks.push_back(chunk);
+        // Handed out in address order
+        for (size_t i = CHUNK_SIZE; i-- > 0;)
+        {
+            chunk[i].next = freeList;
+            freeList = &chunk[i];
+        }
+    }
+
+    std::vector<Slot*> chunks;
+    Slot* freeList = nullptr;
+    size_t liveCount = 0;
+};
+
+#endif // OBJECT_POOL_H
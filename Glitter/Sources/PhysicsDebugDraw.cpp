@@ -0,0 +1,127 @@
+#include "PhysicsDebugDraw.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+static const int CIRCLE_SEGMENTS = 16;
+// Length of the line drawn along a contact's normal
+static const float CONTACT_NORMAL_LENGTH = 0.1f;
+
+static glm::vec3 ToGlm(const btVector3& v)
+{
+    return glm::vec3(v.getX(), v.getY(), v.getZ());
+}
+
+uint32_t PhysicsDebugDraw::Pack(const btVector3& color)
+{
+    uint32_t r = static_cast<uint32_t>(std::min(std::max(color.getX(), btScalar(0)), btScalar(1)) * 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(std::min(std::max(color.getY(), btScalar(0)), btScalar(1)) * 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(std::min(std::max(color.getZ(), btScalar(0)), btScalar(1)) * 255.0f + 0.5f);
+    // Bytes in memory are r, g, b, a
+    return r | (g << 8) | (b << 16) | (255u << 24);
+}
+
+void PhysicsDebugDraw::drawLine(const btVector3& from, const btVector3& to, const btVector3& color)
+{
+    AddLine(ToGlm(from), ToGlm(to), Pack(color));
+}
+
+void PhysicsDebugDraw::drawContactPoint(const btVector3& pointOnB, const btVector3& normalOnB, btScalar /*distance*/,
+                                        int /*lifeTime*/, const btVector3& color)
+{
+    glm::vec3 point = ToGlm(pointOnB);
+    AddLine(point, point + ToGlm(normalOnB) * CONTACT_NORMAL_LENGTH, Pack(color));
+}
+
+void PhysicsDebugDraw::AddBox(const glm::vec3 corners[8], uint32_t color)
+{
+    // Each edge joins two corners whose index differs in one bit
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int axis = 1; axis < 8; axis <<= 1)
+        {
+            if ((i & axis) == 0)
+            {
+                AddLine(corners[i], corners[i | axis], color);
+            }
+        }
+    }
+}
+
+void PhysicsDebugDraw::drawAabb(const btVector3& from, const btVector3& to, const btVector3& color)
+{
+    drawBox(from, to, color);
+}
+
+void PhysicsDebugDraw::drawBox(const btVector3& boxMin, const btVector3& boxMax, const btVector3& color)
+{
+    glm::vec3 low = ToGlm(boxMin);
+    glm::vec3 high = ToGlm(boxMax);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        corners[i] = glm::vec3((i & 1) ? high.x : low.x, (i & 2) ? high.y : low.y, (i & 4) ? high.z : low.z);
+    }
+    AddBox(corners, Pack(color));
+}
+
+void PhysicsDebugDraw::drawBox(const btVector3& boxMin, const btVector3& boxMax, const btTransform& transform,
+                               const btVector3& color)
+{
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        btVector3 corner((i & 1) ? boxMax.getX() : boxMin.getX(),
+                         (i & 2) ? boxMax.getY() : boxMin.getY(),
+                         (i & 4) ? boxMax.getZ() : boxMin.getZ());
+        corners[i] = ToGlm(transform * corner);
+    }
+    AddBox(corners, Pack(color));
+}
+
+void PhysicsDebugDraw::drawSphere(btScalar radius, const btTransform& transform, const btVector3& color)
+{
+    // Same for every sphere, computed once
+    static const std::array<glm::vec2, CIRCLE_SEGMENTS + 1> circle = []
+    {
+        std::array<glm::vec2, CIRCLE_SEGMENTS + 1> points;
+        for (int i = 0; i <= CIRCLE_SEGMENTS; ++i)
+        {
+            float angle = 2.0f * 3.14159265f * i / CIRCLE_SEGMENTS;
+            points[i] = glm::vec2(std::cos(angle), std::sin(angle));
+        }
+        return points;
+    }();
+
+    glm::vec3 center = ToGlm(transform.getOrigin());
+    glm::vec3 axes[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        axes[i] = ToGlm(transform.getBasis().getColumn(i)) * radius;
+    }
+
+    uint32_t packed = Pack(color);
+    // One circle in each of the sphere's planes
+    for (int plane = 0; plane < 3; ++plane)
+    {
+        const glm::vec3& u = axes[plane];
+        const glm::vec3& v = axes[(plane + 1) % 3];
+        for (int i = 0; i < CIRCLE_SEGMENTS; ++i)
+        {
+            AddLine(center + u * circle[i].x + v * circle[i].y,
+                    center + u * circle[i + 1].x + v * circle[i + 1].y, packed);
+        }
+    }
+}
+
+void PhysicsDebugDraw::drawSphere(const btVector3& center, btScalar radius, const btVector3& color)
+{
+    drawSphere(radius, btTransform(btQuaternion(0, 0, 0, 1), center), color);
+}
+
+void PhysicsDebugDraw::reportErrorWarning(const char* warning)
+{
+    printf("ERROR: Bullet: %s\n", warning);
+}
@@ -0,0 +1,61 @@
+#ifndef PHYSICS_DEBUG_DRAW_H
+#define PHYSICS_DEBUG_DRAW_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// One end of a debug line, 16 bytes with the color packed as RGBA8
+struct DebugVertex
+{
+    glm::vec3 position;
+    uint32_t color;
+};
+
+// Collects everything Bullet's debugDrawWorld draws as pairs of line
+// vertices in one array, which DebugLineRenderer uploads and draws
+// with a single call. Boxes, AABBs and spheres are written directly
+// instead of going through drawLine one edge at a time
+class PhysicsDebugDraw : public btIDebugDraw
+{
+public:
+    // Keeps the array's memory for the next frame
+    void Clear() { vertices.clear(); }
+    const std::vector<DebugVertex>& GetVertices() const { return vertices; }
+
+    void drawLine(const btVector3& from, const btVector3& to, const btVector3& color) override;
+    void drawContactPoint(const btVector3& pointOnB, const btVector3& normalOnB, btScalar /*distance*/,
+                          int /*lifeTime*/, const btVector3& color) override;
+    void drawAabb(const btVector3& from, const btVector3& to, const btVector3& color) override;
+    void drawBox(const btVector3& boxMin, const btVector3& boxMax, const btVector3& color) override;
+    void drawBox(const btVector3& boxMin, const btVector3& boxMax, const btTransform& transform,
+                 const btVector3& color) override;
+    // Three circles instead of Bullet's latitude and longitude patch
+    void drawSphere(btScalar radius, const btTransform& transform, const btVector3& color) override;
+    void drawSphere(const btVector3& center, btScalar radius, const btVector3& color) override;
+
+    void reportErrorWarning(const char* warning) override;
+    // No text in the line renderer
+    void draw3dText(const btVector3& /*location*/, const char* /*text*/) override {}
+
+    void setDebugMode(int mode) override { debugMode = mode; }
+    int getDebugMode() const override { return debugMode; }
+
+private:
+    // The 8 corners in world space, bit 0 of the index picks x, bit 1 y, bit 2 z
+    void AddBox(const glm::vec3 corners[8], uint32_t color);
+    void AddLine(const glm::vec3& from, const glm::vec3& to, uint32_t color)
+    {
+        vertices.push_back({ from, color });
+        vertices.push_back({ to, color });
+    }
+    static uint32_t Pack(const btVector3& color);
+
+    std::vector<DebugVertex> vertices;
+    int debugMode = DBG_NoDebug;
+};
+
+#endif // PHYSICS_DEBUG_DRAW_H
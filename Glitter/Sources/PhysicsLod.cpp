@@ -0,0 +1,190 @@
+#include "PhysicsLod.h"
+#include "ObjectMotionState.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Bodies beyond every tier
+static const int SLEEP_TIER = PHYSICS_LOD_TIER_COUNT;
+
+void PhysicsLod::SetSettings(const PhysicsLodSettings& _settings)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    settings = _settings;
+}
+
+PhysicsLodSettings PhysicsLod::GetSettings()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings;
+}
+
+void PhysicsLod::SetFocusPoints(const std::vector<glm::vec3>& points)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    focusPoints.assign(points.begin(), points.end());
+}
+
+void PhysicsLod::BeginStep(btDiscreteDynamicsWorld* world, unsigned long long tick)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stepSettings = settings;
+        stepFocusPoints.assign(focusPoints.begin(), focusPoints.end());
+    }
+
+    PhysicsLodStats previous = stats;
+    stats = PhysicsLodStats();
+    stats.forcedSleeps = previous.forcedSleeps;
+    stats.wakes = previous.wakes;
+
+    if (!stepSettings.enabled || stepFocusPoints.empty())
+    {
+        if (wasEnabled) { WakeAll(world); }
+        wasEnabled = false;
+        return;
+    }
+    wasEnabled = true;
+
+    float radius2[PHYSICS_LOD_TIER_COUNT];
+    for (int t = 0; t < PHYSICS_LOD_TIER_COUNT; ++t)
+    {
+        radius2[t] = stepSettings.tierRadius[t] * stepSettings.tierRadius[t];
+    }
+
+    // Island tags are from the last step, they index the collision
+    // object array. Static bodies have none and don't join islands
+    btCollisionObjectArray& objects = world->getCollisionObjectArray();
+    int count = objects.size();
+    bodyTiers.assign(count, -1);
+    islandTiers.assign(count, SLEEP_TIER);
+    for (int i = 0; i < count; ++i)
+    {
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if (body == nullptr || body->isStaticOrKinematicObject()) { continue; }
+
+        const btVector3& origin = body->getWorldTransform().getOrigin();
+        glm::vec3 position(origin.getX(), origin.getY(), origin.getZ());
+        float nearest2 = FLT_MAX;
+        for (const glm::vec3& focus : stepFocusPoints)
+        {
+            glm::vec3 offset = position - focus;
+            nearest2 = std::min(nearest2, glm::dot(offset, offset));
+        }
+
+        int tier = 0;
+        while (tier < PHYSICS_LOD_TIER_COUNT && nearest2 > radius2[tier]) { ++tier; }
+        bodyTiers[i] = tier;
+
+        int tag = body->getIslandTag();
+        if (tag >= 0 && tag < count)
+        {
+            islandTiers[tag] = std::min(islandTiers[tag], tier);
+        }
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (bodyTiers[i] < 0) { continue; }
+
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        ObjectMotionState* state = static_cast<ObjectMotionState*>(body->getMotionState());
+        int tag = body->getIslandTag();
+        bool hasIsland = tag >= 0 && tag < count;
+        int tier = hasIsland ? islandTiers[tag] : bodyTiers[i];
+
+        if (tier == SLEEP_TIER)
+        {
+            // Once, so a body woken by a contact out here stays awake
+            if (!state->lodAsleep && body->isActive())
+            {
+                body->forceActivationState(ISLAND_SLEEPING);
+                state->lodAsleep = true;
+                ++stats.forcedSleeps;
+            }
+            if (body->isActive()) { ++stats.awakeBodies[SLEEP_TIER]; }
+            continue;
+        }
+
+        if (state->lodAsleep)
+        {
+            state->lodAsleep = false;
+            if (!body->isActive())
+            {
+                body->activate(true);
+                ++stats.wakes;
+            }
+        }
+        // Bodies at rest cost nothing already
+        if (!body->isActive()) { continue; }
+        ++stats.awakeBodies[tier];
+
+        int interval = std::max(1, stepSettings.tickInterval[tier]);
+        if (interval == 1) { continue; }
+
+        // Spread each tier's islands over its ticks
+        unsigned long long phase = static_cast<unsigned long long>(hasIsland ? tag : i);
+        if ((tick + phase) % interval != 0)
+        {
+            // Asleep for this step only. Bullet zeroes the velocities of
+            // bodies still asleep after the step, EndStep puts them back
+            FrozenBody entry = { body, body->getLinearVelocity(), body->getAngularVelocity(),
+                                 body->getActivationState(), body->getDeactivationTime() };
+            frozen.push_back(entry);
+            body->forceActivationState(ISLAND_SLEEPING);
+            ++stats.frozenBodies;
+        }
+        else
+        {
+            // Stepping velocities scaled by n and gravity by n^2 moves the
+            // body as far as n ticks would, velocities are scaled back after
+            btScalar scale = static_cast<btScalar>(interval);
+            ScaledBody entry = { body, scale, body->getGravity() };
+            scaled.push_back(entry);
+            body->setLinearVelocity(body->getLinearVelocity() * scale);
+            body->setAngularVelocity(body->getAngularVelocity() * scale);
+            body->setGravity(entry.gravity * (scale * scale));
+        }
+    }
+}
+
+void PhysicsLod::EndStep()
+{
+    for (const FrozenBody& entry : frozen)
+    {
+        // A body of another island woke it up during the step. It was
+        // stepped from the velocities it had, Bullet's result is right
+        if (entry.body->getActivationState() != ISLAND_SLEEPING) { continue; }
+
+        entry.body->forceActivationState(entry.activationState);
+        entry.body->setDeactivationTime(entry.deactivationTime);
+        entry.body->setLinearVelocity(entry.linearVelocity);
+        entry.body->setAngularVelocity(entry.angularVelocity);
+    }
+    frozen.clear();
+
+    for (const ScaledBody& entry : scaled)
+    {
+        entry.body->setLinearVelocity(entry.body->getLinearVelocity() / entry.scale);
+        entry.body->setAngularVelocity(entry.body->getAngularVelocity() / entry.scale);
+        entry.body->setGravity(entry.gravity);
+    }
+    scaled.clear();
+}
+
+void PhysicsLod::WakeAll(btDiscreteDynamicsWorld* world)
+{
+    btCollisionObjectArray& objects = world->getCollisionObjectArray();
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if (body == nullptr || body->getMotionState() == nullptr) { continue; }
+
+        ObjectMotionState* state = static_cast<ObjectMotionState*>(body->getMotionState());
+        if (!state->lodAsleep) { continue; }
+
+        state->lodAsleep = false;
+        body->activate(true);
+        ++stats.wakes;
+    }
+}
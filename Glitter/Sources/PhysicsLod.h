@@ -0,0 +1,90 @@
+#ifndef PHYSICS_LOD_H
+#define PHYSICS_LOD_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <glm/glm.hpp>
+
+#include <mutex>
+#include <vector>
+
+static const int PHYSICS_LOD_TIER_COUNT = 3;
+
+struct PhysicsLodSettings
+{
+    bool enabled = false;
+    // Outer radius of each tier around the nearest focus point. Bodies
+    // beyond the last one are put to sleep
+    float tierRadius[PHYSICS_LOD_TIER_COUNT] = { 50.0f, 150.0f, 400.0f };
+    // A tier is stepped once every this many ticks
+    int tickInterval[PHYSICS_LOD_TIER_COUNT] = { 1, 2, 4 };
+};
+
+struct PhysicsLodStats
+{
+    // Awake bodies per tier, the last entry is beyond every tier
+    int awakeBodies[PHYSICS_LOD_TIER_COUNT + 1] = {};
+    // Skipped by the last step for not being their tier's turn
+    int frozenBodies = 0;
+    unsigned long long forcedSleeps = 0;
+    unsigned long long wakes = 0;
+};
+
+// Lets far away bodies cost less. Each island of touching bodies gets
+// the tier of its body nearest to a focus point, so bodies in contact
+// are always stepped together:
+// - Far tiers take one tick of every tickInterval. In between they are
+//   frozen asleep, on their tick they are stepped tickInterval ticks
+//   worth by scaling their velocities and gravity for the step
+// - Beyond the last tier bodies are forced to sleep. Bullet wakes them
+//   on contact, a focus point coming close wakes them here
+class PhysicsLod
+{
+public:
+    void SetSettings(const PhysicsLodSettings& settings);
+    PhysicsLodSettings GetSettings();
+    // Usually the active camera, set by the main thread every frame
+    void SetFocusPoints(const std::vector<glm::vec3>& points);
+
+    // Around each stepSimulation, on the thread stepping the world
+    void BeginStep(btDiscreteDynamicsWorld* world, unsigned long long tick);
+    void EndStep();
+
+    PhysicsLodStats GetStats() const { return stats; }
+
+private:
+    // Wakes everything put to sleep here, when LOD is turned off
+    void WakeAll(btDiscreteDynamicsWorld* world);
+
+    struct FrozenBody
+    {
+        btRigidBody* body;
+        btVector3 linearVelocity;
+        btVector3 angularVelocity;
+        int activationState;
+        btScalar deactivationTime;
+    };
+
+    struct ScaledBody
+    {
+        btRigidBody* body;
+        btScalar scale;
+        btVector3 gravity;
+    };
+
+    std::mutex mutex;
+    PhysicsLodSettings settings;
+    std::vector<glm::vec3> focusPoints;
+
+    // Only touched by the stepping thread
+    PhysicsLodSettings stepSettings;
+    std::vector<glm::vec3> stepFocusPoints;
+    bool wasEnabled = false;
+    std::vector<int> bodyTiers;
+    std::vector<int> islandTiers;
+    std::vector<FrozenBody> frozen;
+    std::vector<ScaledBody> scaled;
+    PhysicsLodStats stats;
+};
+
+#endif // PHYSICS_LOD_H
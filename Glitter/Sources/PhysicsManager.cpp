@@ -1,20 +1,145 @@
 #include "PhysicsManager.h"
-#include "Shared.h"
+#include "SimulationThread.h"
 
-void PhysicsManager::Start()
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Axis sweep needs fixed world bounds, bodies outside them still
+// collide but are all lumped into the same cells
+static const btScalar AXIS_SWEEP_EXTENT = 1000.0f;
+
+void PhysicsManager::Start(const PhysicsSettings& _settings)
 {
+    settings = _settings;
     collisionConfiguration = new btDefaultCollisionConfiguration();
 
-    dispatcher = new btCollisionDispatcher(collisionConfiguration);
-
-    overlappingPairCache = new btDbvtBroadphase();
+    std::lock_guard<std::mutex> lock(worldMutex);
+    CreateWorld();
+}
 
-    solver = new btSequentialImpulseConstraintSolver();
+void PhysicsManager::CreateWorld()
+{
+    if (settings.broadphase == BROADPHASE_AXIS_SWEEP)
+    {
+        btVector3 extent(AXIS_SWEEP_EXTENT, AXIS_SWEEP_EXTENT, AXIS_SWEEP_EXTENT);
+        overlappingPairCache = new bt32BitAxisSweep3(-extent, extent);
+        dbvtBroadphase = nullptr;
+    }
+    else
+    {
+        dbvtBroadphase = new btDbvtBroadphase();
+        overlappingPairCache = dbvtBroadphase;
+    }
 
-    dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
+    if (settings.threading == PHYSICS_MULTITHREADED)
+    {
+        // The Mt classes split their work with btParallelFor, which
+        // goes through the scheduler set here
+        btSetTaskScheduler(&taskScheduler);
+        dispatcher = new btCollisionDispatcherMt(collisionConfiguration);
+        solverPool = new btConstraintSolverPoolMt(taskScheduler.getNumThreads());
+        // Solves islands too big for a single pooled solver
+        solver = new btSequentialImpulseConstraintSolverMt();
+        dynamicsWorld = new btDiscreteDynamicsWorldMt(dispatcher, overlappingPairCache,
+                                                      solverPool, solver, collisionConfiguration);
+    }
+    else
+    {
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+        dispatcher = new btCollisionDispatcher(collisionConfiguration);
+        solver = new btSequentialImpulseConstraintSolver();
+        dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
+    }
+    dynamicsWorld->getPairCache()->setOverlapFilterCallback(&layerFilter);
     dynamicsWorld->setGravity(btVector3(0, -10, 0));
 }
 
+void PhysicsManager::DestroyWorld()
+{
+    delete dynamicsWorld;
+    delete solver;
+    delete solverPool;
+    delete overlappingPairCache;
+    delete dispatcher;
+
+    dynamicsWorld = nullptr;
+    solver = nullptr;
+    solverPool = nullptr;
+    overlappingPairCache = nullptr;
+    dbvtBroadphase = nullptr;
+    dispatcher = nullptr;
+}
+
+void PhysicsManager::Configure(const PhysicsSettings& _settings)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    if (_settings.threading == settings.threading && _settings.broadphase == settings.broadphase) { return; }
+    if (recorder.IsOpen())
+    {
+        printf("ERROR: Physics settings can't change while recording\n");
+        return;
+    }
+
+    Rebuild(_settings);
+}
+
+void PhysicsManager::Rebuild(const PhysicsSettings& _settings)
+{
+    // Bodies keep their transforms, velocities and filters, only
+    // their broadphase proxies are made again by the new world
+    struct Removed { btRigidBody* body; int group; int mask; };
+    std::vector<Removed> bodies;
+    btCollisionObjectArray& objects = dynamicsWorld->getCollisionObjectArray();
+    bodies.reserve(objects.size());
+    for (int i = objects.size() - 1; i >= 0; --i)
+    {
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if (body == nullptr) { continue; }
+        btBroadphaseProxy* proxy = body->getBroadphaseHandle();
+        bodies.push_back({ body, proxy->m_collisionFilterGroup, proxy->m_collisionFilterMask });
+        dynamicsWorld->removeRigidBody(body);
+    }
+
+    DestroyWorld();
+    {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        settings = _settings;
+    }
+    CreateWorld();
+
+    for (size_t i = bodies.size(); i-- > 0;)
+    {
+        dynamicsWorld->addRigidBody(bodies[i].body, bodies[i].group, bodies[i].mask);
+    }
+    if (dbvtBroadphase != nullptr)
+    {
+        dbvtBroadphase->optimize();
+    }
+}
+
+PhysicsSettings PhysicsManager::GetSettings()
+{
+    // Not worldMutex, that would wait for a step to finish
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return settings;
+}
+
+PhysicsStats PhysicsManager::GetStats()
+{
+    PhysicsStats result;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        result = stats;
+    }
+    // Changes on scene loads, not steps
+    result.cooking = cooker.GetStats();
+    return result;
+}
+
 void PhysicsManager::AddObject(Object* object)
 {
 
@@ -22,22 +147,204 @@ void PhysicsManager::AddObject(Object* object)
 
 void PhysicsManager::AddObject(GlObject* object)
 {
-    //btCollisionShape* shape = new btBoxShape(btVector3(btScalar(1.0f), btScalar(1.0f), btScalar(1.0f)));
-    glm::vec3 scale = object->scale;
-    btCollisionShape* shape = new btBoxShape(btVector3(scale.x, scale.y, scale.z));
-    collisionShapes.push_back(shape);
+    std::lock_guard<std::mutex> lock(worldMutex);
+    btRigidBody* body = CreateBody(object);
+    AddBody(body, object->collisionLayer);
 
-    btTransform transform;
-    transform.setIdentity();
-    glm::vec3 pos = object->position;
-    transform.setOrigin(btVector3(pos.x, pos.y, pos.z));
+    if (recorder.IsOpen())
+    {
+        PhysicsBodyState state = CaptureState(body, recorder.AssignId(body));
+        recorder.WriteSpawn(&state, 1, false);
+    }
+}
+
+void PhysicsManager::AddObjects(const std::vector<GlObject*>& objects)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+
+    btCollisionObjectArray& collisionObjects = dynamicsWorld->getCollisionObjectArray();
+    collisionObjects.reserve(collisionObjects.size() + static_cast<int>(objects.size()));
+    std::vector<btRigidBody*> bodies;
+    bodies.reserve(objects.size());
+    for (GlObject* object : objects)
+    {
+        bodies.push_back(CreateBody(object));
+        AddBody(bodies.back(), object->collisionLayer);
+    }
+
+    // Inserting one by one leaves the tree shaped by insertion order,
+    // build it again top down now that every proxy is in
+    if (dbvtBroadphase != nullptr)
+    {
+        dbvtBroadphase->optimize();
+    }
+
+    if (recorder.IsOpen())
+    {
+        std::vector<PhysicsBodyState> states;
+        states.reserve(bodies.size());
+        for (btRigidBody* body : bodies)
+        {
+            states.push_back(CaptureState(body, recorder.AssignId(body)));
+        }
+        recorder.WriteSpawn(states.data(), static_cast<uint32_t>(states.size()), true);
+    }
+}
+
+void PhysicsManager::RestoreBodies(const std::vector<GlObject*>& objects, const PhysicsBodyState* states, bool optimize)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+
+    std::vector<btRigidBody*> bodies;
+    bodies.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const PhysicsBodyState& state = states[i];
+        if (state.shapeType != COLLISION_SHAPE_BOX)
+        {
+            printf("ERROR: Can't restore a body with collision shape type %u\n", state.shapeType);
+            continue;
+        }
+
+        btVector3 halfExtents;
+        halfExtents.deSerializeFloat(state.halfExtents);
+        btTransform transform;
+        transform.deSerializeFloat(state.transform);
+        btRigidBody* body = CreateBody(objects[i], shapeCache.GetBox(halfExtents), state.mass, transform);
+
+        btTransform interpolationTransform;
+        interpolationTransform.deSerializeFloat(state.interpolationTransform);
+        btVector3 velocity;
+        body->setInterpolationWorldTransform(interpolationTransform);
+        velocity.deSerializeFloat(state.linearVelocity);
+        body->setLinearVelocity(velocity);
+        velocity.deSerializeFloat(state.angularVelocity);
+        body->setAngularVelocity(velocity);
+        velocity.deSerializeFloat(state.interpolationLinearVelocity);
+        body->setInterpolationLinearVelocity(velocity);
+        velocity.deSerializeFloat(state.interpolationAngularVelocity);
+        body->setInterpolationAngularVelocity(velocity);
+        body->forceActivationState(state.activationState);
+        body->setDeactivationTime(state.deactivationTime);
+
+        bodies.push_back(body);
+        dynamicsWorld->addRigidBody(body, state.collisionGroup, state.collisionMask);
+    }
+
+    if (optimize && dbvtBroadphase != nullptr)
+    {
+        dbvtBroadphase->optimize();
+    }
+
+    if (recorder.IsOpen())
+    {
+        std::vector<PhysicsBodyState> recorded;
+        recorded.reserve(bodies.size());
+        for (btRigidBody* body : bodies)
+        {
+            recorded.push_back(CaptureState(body, recorder.AssignId(body)));
+        }
+        recorder.WriteSpawn(recorded.data(), static_cast<uint32_t>(recorded.size()), optimize);
+    }
+}
+
+void PhysicsManager::ApplyImpulse(GlObject* object, const glm::vec3& impulse)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    std::unordered_map<GlObject*, btRigidBody*>::iterator found = objectBodies.find(object);
+    if (found == objectBodies.end()) { return; }
+
+    btRigidBody* body = found->second;
+    btVector3 value(impulse.x, impulse.y, impulse.z);
+    body->activate(true);
+    body->applyCentralImpulse(value);
+
+    uint32_t id;
+    if (recorder.IsOpen() && recorder.FindId(body, id))
+    {
+        recorder.WriteImpulse(id, value);
+    }
+}
+
+void PhysicsManager::Raycast(RaycastBatch& batch)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    RunRaycasts(dynamicsWorld, batch);
+}
+
+void PhysicsManager::Sweep(SweepBatch& batch)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    RunSweeps(dynamicsWorld, batch);
+}
 
+void PhysicsManager::Overlap(OverlapBatch& batch)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    RunOverlaps(dynamicsWorld, batch);
+}
+
+GlObject* PhysicsManager::Pick(const glm::vec3& from, const glm::vec3& to)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    return RunPick(dynamicsWorld, from, to);
+}
+
+const std::vector<DebugVertex>& PhysicsManager::DrawDebug()
+{
+    debugDraw.Clear();
+    if (debugDraw.getDebugMode() != btIDebugDraw::DBG_NoDebug)
+    {
+        std::lock_guard<std::mutex> lock(worldMutex);
+        // Only set while drawing, steps never see it
+        dynamicsWorld->setDebugDrawer(&debugDraw);
+        dynamicsWorld->debugDrawWorld();
+        dynamicsWorld->setDebugDrawer(nullptr);
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.debugVertices = debugDraw.GetVertices().size();
+    return debugDraw.GetVertices();
+}
+
+btRigidBody* PhysicsManager::CreateBody(GlObject* object)
+{
     btScalar mass(0.0f);
-    if (object->name.compare("Floor") != 0)
+    if (!object->isStatic && object->name.compare("Floor") != 0)
     {
         mass = 1.0f;
     }
 
+    return CreateBody(object, GetShape(object, mass != 0.0f), mass, GetTransform(object));
+}
+
+btCollisionShape* PhysicsManager::GetShape(GlObject* object, bool isDynamic)
+{
+    glm::vec3 scale = object->GetScale();
+    btVector3 shapeScale(scale.x, scale.y, scale.z);
+    if (object->collision != nullptr)
+    {
+        // Bullet only collides triangle meshes with moving convex
+        // shapes, so dynamic models use their hulls
+        return isDynamic ? shapeCache.GetConvexHulls(object->collision->hulls, shapeScale)
+                         : shapeCache.GetScaledMesh(object->collision->triangleMesh, shapeScale);
+    }
+    return shapeCache.GetBox(shapeScale);
+}
+
+btTransform PhysicsManager::GetTransform(GlObject* object)
+{
+    btTransform transform;
+    transform.setIdentity();
+    glm::vec3 pos = object->GetPosition();
+    glm::quat rotation = object->GetRotation();
+    transform.setOrigin(btVector3(pos.x, pos.y, pos.z));
+    transform.setRotation(btQuaternion(rotation.x, rotation.y, rotation.z, rotation.w));
+    return transform;
+}
+
+btRigidBody* PhysicsManager::CreateBody(GlObject* object, btCollisionShape* shape, btScalar mass, const btTransform& transform)
+{
     bool isDynamic = (mass != 0.f);
     //object->rigidBody->isDynamic = (mass != 0.f);
 
@@ -47,69 +354,398 @@ void PhysicsManager::AddObject(GlObject* object)
         shape->calculateLocalInertia(mass, localInertia);
     }
 
-    btDefaultMotionState* motionState = new btDefaultMotionState(transform);
+    ObjectMotionState* motionState = motionStatePool.Create(object, transform, movedStates);
     btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, motionState, shape, localInertia);
-    btRigidBody* body = new btRigidBody(rbInfo);
+    btRigidBody* body = bodyPool.Create(rbInfo);
+    body->setUserPointer(object);
+    objectBodies[object] = body;
+    return body;
+}
+
+PhysicsBodyState PhysicsManager::CaptureState(btRigidBody* body, uint32_t id)
+{
+    PhysicsBodyState state;
+    std::memset(&state, 0, sizeof(state));
+    state.id = id;
+
+    // Cooked model shapes are only named, a replay can't make them
+    // without the model and skips those bodies
+    btVector3 halfExtents(0, 0, 0);
+    if (shapeCache.GetBoxHalfExtents(body->getCollisionShape(), halfExtents))
+    {
+        state.shapeType = COLLISION_SHAPE_BOX;
+    }
+    else
+    {
+        state.shapeType = body->getCollisionShape()->isConcave() ? COLLISION_SHAPE_SCALED_MESH
+                                                                 : COLLISION_SHAPE_CONVEX_HULLS;
+    }
+    halfExtents.serializeFloat(state.halfExtents);
 
-    dynamicsWorld->addRigidBody(body);
+    state.mass = body->getInvMass() == 0.0f ? 0.0f : 1.0f / body->getInvMass();
+    body->getWorldTransform().serializeFloat(state.transform);
+    body->getInterpolationWorldTransform().serializeFloat(state.interpolationTransform);
+    body->getLinearVelocity().serializeFloat(state.linearVelocity);
+    body->getAngularVelocity().serializeFloat(state.angularVelocity);
+    body->getInterpolationLinearVelocity().serializeFloat(state.interpolationLinearVelocity);
+    body->getInterpolationAngularVelocity().serializeFloat(state.interpolationAngularVelocity);
+    state.activationState = body->getActivationState();
+    state.deactivationTime = body->getDeactivationTime();
+    state.collisionGroup = body->getBroadphaseHandle()->m_collisionFilterGroup;
+    state.collisionMask = body->getBroadphaseHandle()->m_collisionFilterMask;
+    return state;
 }
 
-void PhysicsManager::Update()
+// FNV-1a over the bit patterns, so any difference at all shows
+static uint64_t HashVector(uint64_t hash, const btVector3& v)
 {
-    if (false /*GameStatePaused*/) { return; }
+    float values[3] = { v.getX(), v.getY(), v.getZ() };
+    unsigned char bytes[sizeof(values)];
+    std::memcpy(bytes, values, sizeof(values));
+    for (unsigned char byte : bytes)
+    {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
 
-    // Fixed update at 60fps
-    dynamicsWorld->stepSimulation(1.0f/60.0f, 10);
-    for (int i = dynamicsWorld->getNumCollisionObjects()-1; i >= 0; --i)
+uint64_t PhysicsManager::ComputeChecksum()
+{
+    uint64_t hash = 14695981039346656037ull;
+    btCollisionObjectArray& objects = dynamicsWorld->getCollisionObjectArray();
+    for (int i = 0; i < objects.size(); ++i)
     {
-        btCollisionObject* obj = dynamicsWorld->getCollisionObjectArray()[i];
-        btRigidBody* body = btRigidBody::upcast(obj);
-        btTransform trans;
-        if (body && body->getMotionState())
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if (body == nullptr) { continue; }
+
+        const btTransform& transform = body->getWorldTransform();
+        hash = HashVector(hash, transform.getOrigin());
+        for (int row = 0; row < 3; ++row)
+        {
+            hash = HashVector(hash, transform.getBasis()[row]);
+        }
+        hash = HashVector(hash, body->getLinearVelocity());
+        hash = HashVector(hash, body->getAngularVelocity());
+    }
+    return hash;
+}
+
+uint64_t PhysicsManager::GetChecksum()
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    return ComputeChecksum();
+}
+
+static glm::vec3 ToGlm(const btVector3& v)
+{
+    return glm::vec3(v.getX(), v.getY(), v.getZ());
+}
+
+static glm::quat ToGlm(const btQuaternion& q)
+{
+    return glm::quat(q.getW(), q.getX(), q.getY(), q.getZ());
+}
+
+void PhysicsManager::Step(float dt, unsigned long long tick, unsigned long long keepSinceTick,
+                          TransformSnapshot& snapshot)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+
+    // Exactly one fixed step, the simulation thread keeps the time.
+    // Fills movedStates through the motion states
+    std::chrono::steady_clock::time_point stepStart = std::chrono::steady_clock::now();
+    bool useLod = !recorder.IsOpen();
+    if (useLod)
+    {
+        lod.BeginStep(dynamicsWorld, tick);
+    }
+    dynamicsWorld->stepSimulation(dt, 1, dt);
+    if (useLod)
+    {
+        lod.EndStep();
+    }
+    double stepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepStart).count();
+    if (recorder.IsOpen())
+    {
+        recorder.WriteStep(dt, ComputeChecksum());
+    }
+    {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        double& average = stats.stepMs[settings.threading][settings.broadphase];
+        unsigned long long& steps = stats.steps[settings.threading][settings.broadphase];
+        average = steps == 0 ? stepMs : average * 0.95 + stepMs * 0.05;
+        ++steps;
+        stats.bodies = dynamicsWorld->getNumCollisionObjects();
+        stats.overlappingPairs = overlappingPairCache->getOverlappingPairCache()->getNumOverlappingPairs();
+        stats.manifolds = dispatcher->getNumManifolds();
+        stats.lod = lod.GetStats();
+        stats.pairsTested = layerFilter.GetTestedCount();
+        stats.pairsRejectedByLayer = layerFilter.GetRejectedByLayerCount();
+        stats.pairsRejectedStatic = layerFilter.GetRejectedStaticCount();
+        stats.recording = recorder.IsOpen();
+        stats.recordedTicks = recorder.GetTickCount();
+        stats.recordedBytes = recorder.GetBytesWritten();
+    }
+
+    for (ObjectMotionState* state : movedStates)
+    {
+        state->dirty = false;
+        state->movedTick = tick;
+        if (!state->isRecent)
         {
-            body->getMotionState()->getWorldTransform(trans);
+            state->isRecent = true;
+            recentStates.push_back(state);
         }
-        else
+    }
+    movedStates.clear();
+
+    snapshot.entries.clear();
+    snapshot.generation = generation;
+
+    size_t kept = 0;
+    for (ObjectMotionState* state : recentStates)
+    {
+        if (state->movedTick < keepSinceTick)
         {
-            trans = obj->getWorldTransform();
+            state->isRecent = false;
+            continue;
         }
+        recentStates[kept++] = state;
 
-        // Update transform
-        shared.objectManager->glObjectList[i]->position =
-            glm::vec3((float)trans.getOrigin().getX(),
-                      (float)trans.getOrigin().getY(),
-                      (float)trans.getOrigin().getZ());
+        // Bodies at rest this tick are sent without motion
+        const btTransform& previous = state->movedTick == tick ? state->previousTransform : state->transform;
+
+        TransformSnapshot::Entry entry;
+        entry.object = state->object;
+        entry.previousPosition = ToGlm(previous.getOrigin());
+        entry.position = ToGlm(state->transform.getOrigin());
+        entry.previousRotation = ToGlm(previous.getRotation());
+        entry.rotation = ToGlm(state->transform.getRotation());
+        snapshot.entries.push_back(entry);
     }
+    recentStates.resize(kept);
 }
 
-void PhysicsManager::Shutdown()
+void PhysicsManager::DestroyBodies()
 {
-    // remove the rigidbodies from the dynamics world and delete them
     for (int i = dynamicsWorld->getNumCollisionObjects() - 1; i >= 0; --i)
     {
         btCollisionObject* obj = dynamicsWorld->getCollisionObjectArray()[i];
         btRigidBody* body = btRigidBody::upcast(obj);
-        if (body && body->getMotionState())
+        dynamicsWorld->removeCollisionObject(obj);
+        // Every body and motion state comes from the pools
+        if (body)
         {
-            delete body->getMotionState();
+            motionStatePool.Destroy(static_cast<ObjectMotionState*>(body->getMotionState()));
+            bodyPool.Destroy(body);
         }
-        dynamicsWorld->removeCollisionObject(obj);
-        delete obj;
     }
+    movedStates.clear();
+    recentStates.clear();
+    objectBodies.clear();
+}
 
-    // Delete collision shapes
-    for (int i = 0; collisionShapes.size(); ++i)
+void PhysicsManager::RemoveObject(GlObject* object)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    std::unordered_map<GlObject*, btRigidBody*>::iterator found = objectBodies.find(object);
+    if (found == objectBodies.end()) { return; }
+    btRigidBody* body = found->second;
+    objectBodies.erase(found);
+    // Snapshots published before now may still hold the object
+    ++generation;
+
+    if (recorder.IsOpen())
     {
-        btCollisionShape* shape = collisionShapes[i];
-        collisionShapes[i] = 0;
-        delete shape;
+        recorder.WriteRemove(body);
     }
 
-    delete dynamicsWorld;
-    delete solver;
-    delete overlappingPairCache;
-    delete dispatcher;
+    ObjectMotionState* state = static_cast<ObjectMotionState*>(body->getMotionState());
+    movedStates.erase(std::remove(movedStates.begin(), movedStates.end(), state), movedStates.end());
+    recentStates.erase(std::remove(recentStates.begin(), recentStates.end(), state), recentStates.end());
+    dynamicsWorld->removeRigidBody(body);
+    motionStatePool.Destroy(state);
+    bodyPool.Destroy(body);
+}
+
+void PhysicsManager::MoveObject(GlObject* object)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    std::unordered_map<GlObject*, btRigidBody*>::iterator found = objectBodies.find(object);
+    // A replay couldn't teleport the body the same way
+    if (found == objectBodies.end() || recorder.IsOpen()) { return; }
+    btRigidBody* body = found->second;
+
+    // The cache hands back the same shape while the scale is the same
+    bool isDynamic = body->getInvMass() != 0.0f;
+    btCollisionShape* shape = GetShape(object, isDynamic);
+    if (shape != body->getCollisionShape())
+    {
+        body->setCollisionShape(shape);
+        if (isDynamic)
+        {
+            btScalar mass = 1.0f / body->getInvMass();
+            btVector3 localInertia(0, 0, 0);
+            shape->calculateLocalInertia(mass, localInertia);
+            body->setMassProps(mass, localInertia);
+            body->updateInertiaTensor();
+        }
+        // Pairs made with the old shape are dropped with the proxy
+        dynamicsWorld->refreshBroadphaseProxy(body);
+    }
+
+    // Placed, not thrown, so it starts from rest where it was put
+    btTransform transform = GetTransform(object);
+    body->setWorldTransform(transform);
+    body->setInterpolationWorldTransform(transform);
+    body->setLinearVelocity(btVector3(0, 0, 0));
+    body->setAngularVelocity(btVector3(0, 0, 0));
+    body->setInterpolationLinearVelocity(btVector3(0, 0, 0));
+    body->setInterpolationAngularVelocity(btVector3(0, 0, 0));
+    ObjectMotionState* state = static_cast<ObjectMotionState*>(body->getMotionState());
+    state->transform = transform;
+    state->previousTransform = transform;
+
+    // Static bodies aren't in the per step AABB update
+    dynamicsWorld->updateSingleAabb(body);
+    body->activate(true);
+}
+
+void PhysicsManager::RemoveAll()
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    ++generation;
+
+    if (recorder.IsOpen())
+    {
+        recorder.WriteRemoveAll();
+    }
+    // Shapes stay cached, the next scene likely uses the same ones
+    DestroyBodies();
+}
+
+void PhysicsManager::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+
+    recorder.Close();
+    DestroyBodies();
+    shapeCache.Clear();
+    cooker.Clear();
+
+    DestroyWorld();
+    btSetTaskScheduler(btGetSequentialTaskScheduler());
     delete collisionConfiguration;
+    collisionConfiguration = nullptr;
+}
+
+bool PhysicsManager::StartRecording(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    if (!recorder.Open(path, settings.broadphase)) { return false; }
+
+    // Multithreaded steps depend on how the work was split between
+    // threads. A new world also drops contact caches and broadphase
+    // ids, which the log couldn't bring back
+    settingsBeforeRecording = settings;
+    PhysicsSettings recorded = settings;
+    recorded.threading = PHYSICS_SINGLE_THREADED;
+    Rebuild(recorded);
+
+    // Rebuild added the bodies back in order and optimized the tree,
+    // the same as restoring them in one batch does
+    btCollisionObjectArray& objects = dynamicsWorld->getCollisionObjectArray();
+    std::vector<PhysicsBodyState> states;
+    states.reserve(objects.size());
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if (body == nullptr) { continue; }
+        states.push_back(CaptureState(body, recorder.AssignId(body)));
+    }
+    recorder.WriteSpawn(states.data(), static_cast<uint32_t>(states.size()), true);
+
+    std::lock_guard<std::mutex> statsLock(statsMutex);
+    stats.recording = true;
+    stats.recordedTicks = 0;
+    stats.recordedBytes = recorder.GetBytesWritten();
+    return true;
+}
+
+void PhysicsManager::StopRecording()
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    if (!recorder.IsOpen()) { return; }
+    recorder.Close();
 
-    collisionShapes.clear();
+    // Back to the threading the world had before the recording
+    if (settingsBeforeRecording.threading != settings.threading)
+    {
+        Rebuild(settingsBeforeRecording);
+    }
+
+    std::lock_guard<std::mutex> statsLock(statsMutex);
+    stats.recording = false;
+}
+
+void PhysicsManager::AddBody(btRigidBody* body, int layer)
+{
+    dynamicsWorld->addRigidBody(body, collisionLayers.GetGroup(layer), collisionLayers.GetMask(layer));
+}
+
+void PhysicsManager::RefreshFilter(btRigidBody* body, int layer)
+{
+    btBroadphaseProxy* proxy = body->getBroadphaseHandle();
+    int group = collisionLayers.GetGroup(layer);
+    int mask = collisionLayers.GetMask(layer);
+    if (proxy->m_collisionFilterGroup == group && proxy->m_collisionFilterMask == mask) { return; }
+
+    proxy->m_collisionFilterGroup = group;
+    proxy->m_collisionFilterMask = mask;
+    // Makes the proxy again, so pairs are filtered with the new masks
+    dynamicsWorld->refreshBroadphaseProxy(body);
+    body->activate(true);
+}
+
+void PhysicsManager::SetCollisionLayers(const CollisionLayers& layers)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    if (recorder.IsOpen())
+    {
+        printf("ERROR: Collision layers can't change while recording\n");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        collisionLayers = layers;
+    }
+
+    for (std::pair<GlObject* const, btRigidBody*>& entry : objectBodies)
+    {
+        RefreshFilter(entry.second, entry.first->collisionLayer);
+    }
+}
+
+CollisionLayers PhysicsManager::GetCollisionLayers()
+{
+    // Not worldMutex, that would wait for a step to finish
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return collisionLayers;
+}
+
+void PhysicsManager::SetObjectLayer(GlObject* object, int layer)
+{
+    std::lock_guard<std::mutex> lock(worldMutex);
+    if (recorder.IsOpen())
+    {
+        printf("ERROR: Collision layers can't change while recording\n");
+        return;
+    }
+    object->collisionLayer = layer;
+
+    std::unordered_map<GlObject*, btRigidBody*>::iterator found = objectBodies.find(object);
+    if (found != objectBodies.end())
+    {
+        RefreshFilter(found->second, layer);
+    }
 }
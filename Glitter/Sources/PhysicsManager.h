@@ -3,24 +3,213 @@
 
 #include "btBulletDynamicsCommon.h"
 #include "Object.h"
+#include "ObjectMotionState.h"
+#include "ObjectPool.h"
+#include "CollisionShapeCache.h"
+#include "CollisionCooker.h"
+#include "CollisionLayers.h"
+#include "JobTaskScheduler.h"
+#include "PhysicsDebugDraw.h"
+#include "PhysicsLod.h"
+#include "PhysicsQueries.h"
+#include "PhysicsRecording.h"
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
 
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TransformSnapshot;
+
+enum PhysicsThreading
+{
+    PHYSICS_SINGLE_THREADED,
+    // btDiscreteDynamicsWorldMt with its loops run on the JobSystem
+    PHYSICS_MULTITHREADED,
+    PHYSICS_THREADING_COUNT
+};
+
+enum PhysicsBroadphase
+{
+    BROADPHASE_DBVT,
+    // Sweep and prune, good for many bodies that barely move
+    BROADPHASE_AXIS_SWEEP,
+    BROADPHASE_COUNT
+};
+
+struct PhysicsSettings
+{
+    PhysicsThreading threading = PHYSICS_SINGLE_THREADED;
+    PhysicsBroadphase broadphase = BROADPHASE_DBVT;
+};
+
+struct PhysicsStats
+{
+    // Average stepSimulation time of each mode that has been used,
+    // so switching modes on the same scene compares them
+    double stepMs[PHYSICS_THREADING_COUNT][BROADPHASE_COUNT] = {};
+    unsigned long long steps[PHYSICS_THREADING_COUNT][BROADPHASE_COUNT] = {};
+    int bodies = 0;
+    int overlappingPairs = 0;
+    int manifolds = 0;
+
+    PhysicsLodStats lod;
+
+    // New broadphase pairs seen by the layer filter since Start
+    unsigned long long pairsTested = 0;
+    unsigned long long pairsRejectedByLayer = 0;
+    unsigned long long pairsRejectedStatic = 0;
+
+    CollisionCooker::Stats cooking;
+
+    // Line vertices written by the last DrawDebug
+    size_t debugVertices = 0;
+
+    bool recording = false;
+    unsigned long long recordedTicks = 0;
+    size_t recordedBytes = 0;
+};
+
+// The world is stepped by the SimulationThread, every function here
+// may be called from either thread
 class PhysicsManager
 {
 public:
-    void Start();
+    void Start(const PhysicsSettings& settings = PhysicsSettings());
+    // Rebuilds the world for another threading mode or broadphase,
+    // keeping every body where it is
+    void Configure(const PhysicsSettings& settings);
+    PhysicsSettings GetSettings();
     void AddObject(Object*);
     void AddObject(GlObject*);
-    void Update();
+    // Adds a whole scene at once, rebuilding the broadphase tree a
+    // single time at the end instead of growing it body by body
+    void AddObjects(const std::vector<GlObject*>& objects);
+    // Adds bodies exactly as they were recorded, states[i] is objects[i]
+    void RestoreBodies(const std::vector<GlObject*>& objects, const PhysicsBodyState* states, bool optimize);
+    void ApplyImpulse(GlObject* object, const glm::vec3& impulse);
+    // Collision shapes for a model, set as the object's collision
+    // before it's added. Loaded from the cooking cache when they can be
+    const CookedCollision* CookCollision(const std::string& path, const std::vector<CollisionMeshPart>& parts)
+    {
+        return cooker.Get(path, parts);
+    }
+    // Advances the world by one fixed tick and writes the transforms
+    // before and after it of the bodies that moved into snapshot. Bodies
+    // that stopped moving at or after keepSinceTick are still included,
+    // the reader hasn't seen a snapshot with them at rest yet
+    void Step(float dt, unsigned long long tick, unsigned long long keepSinceTick,
+              TransformSnapshot& snapshot);
+    // Removes the object's body, if it has one
+    void RemoveObject(GlObject* object);
+    // Puts the object's body where the object is now, e.g. after an
+    // edit in the inspector, and at rest. A new scale gets a new shape.
+    // Does nothing while recording, editors check stats.recording first
+    void MoveObject(GlObject* object);
+    // Removes every body, before the objects they belong to are deleted
+    void RemoveAll();
+    // Changes whenever bodies are removed, so snapshots pointing
+    // at deleted objects can be told apart
+    unsigned int GetGeneration() { return generation; }
+    PhysicsStats GetStats();
+    // Replaces the layer table, e.g. with a scene's, and moves every
+    // body to the layer its object names
+    void SetCollisionLayers(const CollisionLayers& layers);
+    CollisionLayers GetCollisionLayers();
+    void SetObjectLayer(GlObject* object, int layer);
+
+    // Level of detail by distance, see PhysicsLod
+    void SetLodSettings(const PhysicsLodSettings& settings) { lod.SetSettings(settings); }
+    PhysicsLodSettings GetLodSettings() { return lod.GetSettings(); }
+    void SetLodFocusPoints(const std::vector<glm::vec3>& points) { lod.SetFocusPoints(points); }
+
+    // Batched scene queries, split over the JobSystem. The world is
+    // held still while a batch runs, so every query of it sees the
+    // same tick and the next step waits for the batch
+    void Raycast(RaycastBatch& batch);
+    void Sweep(SweepBatch& batch);
+    void Overlap(OverlapBatch& batch);
+    // Object under a ray through the world, for picking in the editor
+    GlObject* Pick(const glm::vec3& from, const glm::vec3& to);
+
+    // btIDebugDraw::DebugDrawModes bits, none draws nothing
+    void SetDebugDrawMode(int mode) { debugDraw.setDebugMode(mode); }
+    int GetDebugDrawMode() { return debugDraw.getDebugMode(); }
+    // Game thread. Lines outlining the world in the enabled modes, valid
+    // until the next call. Waits for a running step, like the queries
+    const std::vector<DebugVertex>& DrawDebug();
+
+    // Hash of every body's transform and velocity, replays compare it
+    // tick by tick with the recorded one
+    uint64_t GetChecksum();
     void Shutdown();
 
+    // Logs the world and every change made to it from now on to path.
+    // Switches to single threaded mode and rebuilds the world first,
+    // so a replay can start from the exact same state. LOD is paused
+    // while recording, focus points aren't part of the log
+    bool StartRecording(const std::string& path);
+    void StopRecording();
+
 private:
-    btDefaultCollisionConfiguration* collisionConfiguration;
-    btCollisionDispatcher* dispatcher;
-    btBroadphaseInterface* overlappingPairCache;
-    btSequentialImpulseConstraintSolver* solver;
-    btDiscreteDynamicsWorld* dynamicsWorld;
+    // Caller holds worldMutex
+    btRigidBody* CreateBody(GlObject* object);
+    btCollisionShape* GetShape(GlObject* object, bool isDynamic);
+    btTransform GetTransform(GlObject* object);
+    btRigidBody* CreateBody(GlObject* object, btCollisionShape* shape, btScalar mass, const btTransform& transform);
+    void Rebuild(const PhysicsSettings& settings);
+    void AddBody(btRigidBody* body, int layer);
+    // New filter on an existing body, dropping pairs it no longer has
+    void RefreshFilter(btRigidBody* body, int layer);
+    PhysicsBodyState CaptureState(btRigidBody* body, uint32_t id);
+    uint64_t ComputeChecksum();
+    void DestroyBodies();
+    void CreateWorld();
+    void DestroyWorld();
+
+    // Written under both mutexes, read under either
+    PhysicsSettings settings;
+    // Restored by StopRecording
+    PhysicsSettings settingsBeforeRecording;
+    JobTaskScheduler taskScheduler;
+
+    btDefaultCollisionConfiguration* collisionConfiguration = nullptr;
+    btCollisionDispatcher* dispatcher = nullptr;
+    btBroadphaseInterface* overlappingPairCache = nullptr;
+    // Same as overlappingPairCache when it's a Dbvt, for the bulk rebuild
+    btDbvtBroadphase* dbvtBroadphase = nullptr;
+    btConstraintSolver* solver = nullptr;
+    // Multithreaded mode only, one solver per thread for small islands
+    btConstraintSolverPoolMt* solverPool = nullptr;
+    btDiscreteDynamicsWorld* dynamicsWorld = nullptr;
+
+    CollisionShapeCache shapeCache;
+    CollisionCooker cooker;
+    // Written under both mutexes, like settings
+    CollisionLayers collisionLayers;
+    CollisionLayerFilter layerFilter;
+    ObjectPool<btRigidBody> bodyPool;
+    ObjectPool<ObjectMotionState> motionStatePool;
+
+    // Dirtied by Bullet during the current step
+    std::vector<ObjectMotionState*> movedStates;
+    // Moved recently enough to be in the next snapshot
+    std::vector<ObjectMotionState*> recentStates;
+    std::unordered_map<GlObject*, btRigidBody*> objectBodies;
+
+    PhysicsLod lod;
+    PhysicsRecorder recorder;
+    // Only used by the game thread
+    PhysicsDebugDraw debugDraw;
+
+    // Held while the world is stepped or changed
+    std::mutex worldMutex;
+    std::atomic<unsigned int> generation{ 0 };
 
-    btAlignedObjectArray<btCollisionShape*> collisionShapes;
+    std::mutex statsMutex;
+    PhysicsStats stats;
 };
 
 #endif // PHYSICS_MANAGER_H
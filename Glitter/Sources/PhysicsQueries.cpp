@@ -0,0 +1,307 @@
+#include "PhysicsQueries.h"
+#include "JobSystem.h"
+#include "GlObject.h"
+#include "CollisionCooker.h"
+
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+
+#include <algorithm>
+#include <mutex>
+
+// Queries are cheap, fewer per job would spend more on scheduling
+static const size_t QUERY_CHUNK = 64;
+
+static btVector3 ToBullet(const glm::vec3& v)
+{
+    return btVector3(v.x, v.y, v.z);
+}
+
+static glm::vec3 ToGlm(const btVector3& v)
+{
+    return glm::vec3(v.getX(), v.getY(), v.getZ());
+}
+
+// Bodies carry their GlObject, see PhysicsManager::CreateBody
+static GlObject* ObjectOf(const btCollisionObject* body)
+{
+    return static_cast<GlObject*>(body->getUserPointer());
+}
+
+// ===================================================================
+// Raycasts and sweeps
+void RunRaycasts(btCollisionWorld* world, RaycastBatch& batch)
+{
+    batch.results.Resize(batch.from.size());
+    QueryHits& results = batch.results;
+    jobSystem.ParallelFor(batch.from.size(), QUERY_CHUNK, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            btVector3 from = ToBullet(batch.from[i]);
+            btVector3 to = ToBullet(batch.to[i]);
+            btCollisionWorld::ClosestRayResultCallback callback(from, to);
+            // Every group, so only the mask decides
+            callback.m_collisionFilterGroup = -1;
+            callback.m_collisionFilterMask = batch.layerMask;
+            world->rayTest(from, to, callback);
+
+            results.hit[i] = callback.hasHit() ? 1 : 0;
+            results.fraction[i] = callback.m_closestHitFraction;
+            results.position[i] = ToGlm(callback.m_hitPointWorld);
+            results.normal[i] = ToGlm(callback.m_hitNormalWorld);
+            results.object[i] = callback.hasHit() ? ObjectOf(callback.m_collisionObject) : nullptr;
+        }
+    });
+}
+
+void RunSweeps(btCollisionWorld* world, SweepBatch& batch)
+{
+    batch.results.Resize(batch.from.size());
+    QueryHits& results = batch.results;
+    jobSystem.ParallelFor(batch.from.size(), QUERY_CHUNK, [&](size_t begin, size_t end)
+    {
+        btQuaternion rotation(0, 0, 0, 1);
+        for (size_t i = begin; i < end; ++i)
+        {
+            btSphereShape sphere(batch.radius[i]);
+            btVector3 from = ToBullet(batch.from[i]);
+            btVector3 to = ToBullet(batch.to[i]);
+            btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+            callback.m_collisionFilterGroup = -1;
+            callback.m_collisionFilterMask = batch.layerMask;
+            world->convexSweepTest(&sphere, btTransform(rotation, from), btTransform(rotation, to), callback);
+
+            results.hit[i] = callback.hasHit() ? 1 : 0;
+            results.fraction[i] = callback.m_closestHitFraction;
+            results.position[i] = ToGlm(callback.m_hitPointWorld);
+            results.normal[i] = ToGlm(callback.m_hitNormalWorld);
+            results.object[i] = callback.hasHit() ? ObjectOf(callback.m_hitCollisionObject) : nullptr;
+        }
+    });
+}
+
+// ===================================================================
+// Overlaps. Bullet's contactTest goes through the dispatcher, which
+// makes contact manifolds and isn't safe to share between threads.
+// Spheres are tested here directly against the body shapes instead
+
+// Closest point of triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+static btVector3 ClosestPointOnTriangle(const btVector3& p, const btVector3& a, const btVector3& b, const btVector3& c)
+{
+    btVector3 ab = b - a;
+    btVector3 ac = c - a;
+    btVector3 ap = p - a;
+    btScalar d1 = ab.dot(ap);
+    btScalar d2 = ac.dot(ap);
+    if (d1 <= 0 && d2 <= 0) { return a; }
+
+    btVector3 bp = p - b;
+    btScalar d3 = ab.dot(bp);
+    btScalar d4 = ac.dot(bp);
+    if (d3 >= 0 && d4 <= d3) { return b; }
+
+    btScalar vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) { return a + ab * (d1 / (d1 - d3)); }
+
+    btVector3 cp = p - c;
+    btScalar d5 = ab.dot(cp);
+    btScalar d6 = ac.dot(cp);
+    if (d6 >= 0 && d5 <= d6) { return c; }
+
+    btScalar vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) { return a + ac * (d2 / (d2 - d6)); }
+
+    btScalar va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    btScalar denominator = 1 / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+struct SphereTriangleCallback : public btTriangleCallback
+{
+    btVector3 center;
+    btScalar radius2 = 0;
+    bool hit = false;
+
+    void processTriangle(btVector3* triangle, int /*partId*/, int /*triangleIndex*/) override
+    {
+        if (hit) { return; }
+        btVector3 closest = ClosestPointOnTriangle(center, triangle[0], triangle[1], triangle[2]);
+        hit = (closest - center).length2() <= radius2;
+    }
+};
+
+static bool SphereOverlaps(const btVector3& center, btScalar radius,
+                           const btCollisionShape* shape, const btTransform& transform)
+{
+    if (shape->isCompound())
+    {
+        const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+        for (int i = 0; i < compound->getNumChildShapes(); ++i)
+        {
+            if (SphereOverlaps(center, radius, compound->getChildShape(i),
+                               transform * compound->getChildTransform(i)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (shape->isConvex())
+    {
+        // GJK between the cores, the sphere's is its center
+        const btConvexShape* convex = static_cast<const btConvexShape*>(shape);
+        btSphereShape sphere(radius);
+        btTransform sphereTransform(btQuaternion(0, 0, 0, 1), center);
+        btGjkEpaSolver2::sResults result;
+        if (btGjkEpaSolver2::Distance(&sphere, sphereTransform, convex, transform,
+                                      transform.getOrigin() - center, result))
+        {
+            return result.distance <= radius + convex->getMargin();
+        }
+        return result.status == btGjkEpaSolver2::sResults::Penetrating;
+    }
+
+    if (shape->isConcave())
+    {
+        // Triangles come in the shape's space, scale included
+        SphereTriangleCallback callback;
+        callback.center = transform.invXform(center);
+        callback.radius2 = radius * radius;
+        btVector3 extent(radius, radius, radius);
+        static_cast<const btConcaveShape*>(shape)->processAllTriangles(&callback, callback.center - extent,
+                                                                       callback.center + extent);
+        return callback.hit;
+    }
+    return false;
+}
+
+struct OverlapCandidates : public btBroadphaseAabbCallback
+{
+    std::vector<const btCollisionObject*> bodies;
+    int layerMask = -1;
+
+    bool process(const btBroadphaseProxy* proxy) override
+    {
+        if ((proxy->m_collisionFilterGroup & layerMask) != 0)
+        {
+            bodies.push_back(static_cast<const btCollisionObject*>(proxy->m_clientObject));
+        }
+        return true;
+    }
+};
+
+void RunOverlaps(btCollisionWorld* world, OverlapBatch& batch)
+{
+    size_t count = batch.center.size();
+    batch.firstObject.resize(count);
+    batch.objectCount.resize(count);
+    batch.objects.clear();
+
+    // Each chunk lists its objects on its own, they are joined in
+    // query order at the end
+    struct Chunk
+    {
+        size_t begin;
+        std::vector<GlObject*> objects;
+    };
+    std::vector<Chunk> chunks;
+    std::mutex chunksMutex;
+
+    jobSystem.ParallelFor(count, QUERY_CHUNK, [&](size_t begin, size_t end)
+    {
+        Chunk chunk;
+        chunk.begin = begin;
+        OverlapCandidates candidates;
+        candidates.layerMask = batch.layerMask;
+        for (size_t i = begin; i < end; ++i)
+        {
+            btVector3 center = ToBullet(batch.center[i]);
+            btScalar radius = batch.radius[i];
+            btVector3 extent(radius, radius, radius);
+            candidates.bodies.clear();
+            world->getBroadphase()->aabbTest(center - extent, center + extent, candidates);
+
+            batch.firstObject[i] = static_cast<uint32_t>(chunk.objects.size());
+            for (const btCollisionObject* body : candidates.bodies)
+            {
+                if (SphereOverlaps(center, radius, body->getCollisionShape(), body->getWorldTransform()))
+                {
+                    chunk.objects.push_back(ObjectOf(body));
+                }
+            }
+            batch.objectCount[i] = static_cast<uint32_t>(chunk.objects.size()) - batch.firstObject[i];
+        }
+
+        std::lock_guard<std::mutex> lock(chunksMutex);
+        chunks.push_back(std::move(chunk));
+    });
+
+    std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.begin < b.begin; });
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        size_t end = c + 1 < chunks.size() ? chunks[c + 1].begin : count;
+        uint32_t offset = static_cast<uint32_t>(batch.objects.size());
+        for (size_t i = chunks[c].begin; i < end; ++i)
+        {
+            batch.firstObject[i] += offset;
+        }
+        batch.objects.insert(batch.objects.end(), chunks[c].objects.begin(), chunks[c].objects.end());
+    }
+}
+
+// ===================================================================
+// Picking
+struct ClosestTriangleCallback : public btTriangleRaycastCallback
+{
+    ClosestTriangleCallback(const btVector3& from, const btVector3& to) : btTriangleRaycastCallback(from, to) {}
+
+    // Becomes m_hitFraction, only closer triangles are reported after
+    btScalar reportHit(const btVector3& /*normal*/, btScalar hitFraction, int /*partId*/, int /*triangleIndex*/) override
+    {
+        return hitFraction;
+    }
+};
+
+GlObject* RunPick(btCollisionWorld* world, const glm::vec3& rayFrom, const glm::vec3& rayTo)
+{
+    btVector3 from = ToBullet(rayFrom);
+    btVector3 to = ToBullet(rayTo);
+    btCollisionWorld::AllHitsRayResultCallback callback(from, to);
+    callback.m_collisionFilterGroup = -1;
+    world->rayTest(from, to, callback);
+
+    GlObject* closest = nullptr;
+    btScalar closestFraction = 2;
+    for (int i = 0; i < callback.m_collisionObjects.size(); ++i)
+    {
+        btScalar fraction = callback.m_hitFractions[i];
+        if (fraction >= closestFraction) { continue; }
+
+        const btCollisionObject* body = callback.m_collisionObjects[i];
+        GlObject* object = ObjectOf(body);
+        if (object->collision != nullptr && !body->getCollisionShape()->isConcave())
+        {
+            // The ray only hit the hulls around the model. Fractions
+            // don't change with the transform, the ray is cast in the
+            // unscaled mesh's space
+            btVector3 scale = ToBullet(object->GetScale());
+            btVector3 localFrom = body->getWorldTransform().invXform(from) / scale;
+            btVector3 localTo = body->getWorldTransform().invXform(to) / scale;
+            ClosestTriangleCallback triangles(localFrom, localTo);
+            object->collision->triangleMesh->performRaycast(&triangles, localFrom, localTo);
+            if (triangles.m_hitFraction >= 1 || triangles.m_hitFraction >= closestFraction) { continue; }
+            fraction = triangles.m_hitFraction;
+        }
+
+        closest = object;
+        closestFraction = fraction;
+    }
+    return closest;
+}
@@ -0,0 +1,81 @@
+#ifndef PHYSICS_QUERIES_H
+#define PHYSICS_QUERIES_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class GlObject;
+
+// Closest hit of every query of a batch, query i's at index i
+struct QueryHits
+{
+    // Bytes rather than vector<bool>, threads write neighbouring entries
+    std::vector<uint8_t> hit;
+    // Along the query from 0 to 1
+    std::vector<float> fraction;
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> normal;
+    std::vector<GlObject*> object;
+
+    void Resize(size_t count)
+    {
+        hit.resize(count);
+        fraction.resize(count);
+        position.resize(count);
+        normal.resize(count);
+        object.resize(count);
+    }
+};
+
+// Rays from from[i] to to[i]
+struct RaycastBatch
+{
+    std::vector<glm::vec3> from;
+    std::vector<glm::vec3> to;
+    // Bits of the collision layers the rays hit, see CollisionLayers
+    int layerMask = -1;
+
+    QueryHits results;
+};
+
+// Spheres of radius[i] moved from from[i] to to[i]
+struct SweepBatch
+{
+    std::vector<glm::vec3> from;
+    std::vector<glm::vec3> to;
+    std::vector<float> radius;
+    int layerMask = -1;
+
+    QueryHits results;
+};
+
+// Every object touching the sphere of radius[i] around center[i]
+struct OverlapBatch
+{
+    std::vector<glm::vec3> center;
+    std::vector<float> radius;
+    int layerMask = -1;
+
+    // Query i's objects are objects[firstObject[i]] onwards,
+    // objectCount[i] of them
+    std::vector<uint32_t> firstObject;
+    std::vector<uint32_t> objectCount;
+    std::vector<GlObject*> objects;
+};
+
+// Run by PhysicsManager with its world lock held, nothing moves while
+// the queries are split over the JobSystem. Bullet's queries only
+// read the world and keep their state on the stack, except the
+// Dbvt ray stacks which BT_THREADSAFE gives one per thread
+void RunRaycasts(btCollisionWorld* world, RaycastBatch& batch);
+void RunSweeps(btCollisionWorld* world, SweepBatch& batch);
+void RunOverlaps(btCollisionWorld* world, OverlapBatch& batch);
+// Closest object along the ray, null if there is none. Models with
+// hull bodies are tested against their cooked triangles
+GlObject* RunPick(btCollisionWorld* world, const glm::vec3& from, const glm::vec3& to);
+
+#endif // PHYSICS_QUERIES_H
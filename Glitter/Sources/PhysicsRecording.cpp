@@ -0,0 +1,216 @@
+#include "PhysicsRecording.h"
+
+#include <algorithm>
+
+static const char LOG_MAGIC[4] = { 'T', 'P', 'H', 'L' };
+static const uint32_t LOG_VERSION = 3;
+
+// Raw struct layout depends on the compiler and on btScalar, a log
+// is only read back by a build that writes the same one
+struct PhysicsLogHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t bodyStateSize;
+    uint32_t broadphase;
+};
+
+// ===================================================================
+// PhysicsRecorder
+PhysicsRecorder::~PhysicsRecorder()
+{
+    Close();
+}
+
+bool PhysicsRecorder::Open(const std::string& path, int broadphase)
+{
+    Close();
+
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("ERROR: Failed to open physics log for writing: %s\n", path.c_str());
+        return false;
+    }
+
+    ids.clear();
+    nextId = 0;
+    ticks = 0;
+    bytesWritten = 0;
+
+    PhysicsLogHeader header;
+    std::copy(LOG_MAGIC, LOG_MAGIC + 4, header.magic);
+    header.version = LOG_VERSION;
+    header.bodyStateSize = sizeof(PhysicsBodyState);
+    header.broadphase = static_cast<uint32_t>(broadphase);
+    Write(header);
+    return true;
+}
+
+void PhysicsRecorder::Close()
+{
+    if (file == nullptr) { return; }
+
+    Write(PHYSICS_LOG_END);
+    fclose(file);
+    file = nullptr;
+    ids.clear();
+}
+
+uint32_t PhysicsRecorder::AssignId(const btCollisionObject* body)
+{
+    uint32_t id = nextId++;
+    ids[body] = id;
+    return id;
+}
+
+bool PhysicsRecorder::FindId(const btCollisionObject* body, uint32_t& id) const
+{
+    std::unordered_map<const btCollisionObject*, uint32_t>::const_iterator found = ids.find(body);
+    if (found == ids.end()) { return false; }
+
+    id = found->second;
+    return true;
+}
+
+void PhysicsRecorder::WriteSpawn(const PhysicsBodyState* states, uint32_t count, bool optimize)
+{
+    Write(PHYSICS_LOG_SPAWN);
+    Write(count);
+    Write(static_cast<uint8_t>(optimize));
+    Write(states, count * sizeof(PhysicsBodyState));
+}
+
+void PhysicsRecorder::WriteImpulse(uint32_t id, const btVector3& impulse)
+{
+    btVector3FloatData data;
+    impulse.serializeFloat(data);
+
+    Write(PHYSICS_LOG_IMPULSE);
+    Write(id);
+    Write(data);
+}
+
+void PhysicsRecorder::WriteRemove(const btCollisionObject* body)
+{
+    std::unordered_map<const btCollisionObject*, uint32_t>::iterator found = ids.find(body);
+    if (found == ids.end()) { return; }
+
+    Write(PHYSICS_LOG_REMOVE);
+    Write(found->second);
+    ids.erase(found);
+}
+
+void PhysicsRecorder::WriteRemoveAll()
+{
+    Write(PHYSICS_LOG_REMOVE_ALL);
+    ids.clear();
+}
+
+void PhysicsRecorder::WriteStep(float dt, uint64_t checksum)
+{
+    Write(PHYSICS_LOG_STEP);
+    Write(dt);
+    Write(checksum);
+    ++ticks;
+}
+
+void PhysicsRecorder::Write(const void* data, size_t size)
+{
+    // stdio buffers it, a tick is usually a handful of bytes
+    fwrite(data, 1, size, file);
+    bytesWritten += size;
+}
+
+// ===================================================================
+// PhysicsLogReader
+PhysicsLogReader::~PhysicsLogReader()
+{
+    Close();
+}
+
+bool PhysicsLogReader::Open(const std::string& _path)
+{
+    Close();
+    path = _path;
+
+    file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        printf("ERROR: Failed to open physics log: %s\n", path.c_str());
+        return false;
+    }
+
+    PhysicsLogHeader header;
+    if (!Read(header) || !std::equal(LOG_MAGIC, LOG_MAGIC + 4, header.magic))
+    {
+        printf("ERROR: Not a physics log: %s\n", path.c_str());
+        Close();
+        return false;
+    }
+    if (header.version != LOG_VERSION || header.bodyStateSize != sizeof(PhysicsBodyState))
+    {
+        printf("ERROR: Physics log %s was written by an incompatible build\n", path.c_str());
+        Close();
+        return false;
+    }
+
+    broadphase = static_cast<int>(header.broadphase);
+    return true;
+}
+
+void PhysicsLogReader::Close()
+{
+    if (file == nullptr) { return; }
+
+    fclose(file);
+    file = nullptr;
+}
+
+bool PhysicsLogReader::Next(PhysicsLogEntry& entry)
+{
+    if (file == nullptr || !Read(entry.type)) { return false; }
+
+    bool complete = true;
+    switch (entry.type)
+    {
+    case PHYSICS_LOG_SPAWN:
+    {
+        uint32_t count = 0;
+        uint8_t optimize = 0;
+        complete = Read(count) && Read(optimize);
+        if (complete)
+        {
+            entry.bodies.resize(count);
+            entry.optimize = optimize != 0;
+            complete = Read(entry.bodies.data(), count * sizeof(PhysicsBodyState));
+        }
+        break;
+    }
+    case PHYSICS_LOG_IMPULSE:
+        complete = Read(entry.id) && Read(entry.impulse);
+        break;
+    case PHYSICS_LOG_REMOVE:
+        complete = Read(entry.id);
+        break;
+    case PHYSICS_LOG_REMOVE_ALL:
+        break;
+    case PHYSICS_LOG_STEP:
+        complete = Read(entry.dt) && Read(entry.checksum);
+        break;
+    default:
+        // PHYSICS_LOG_END
+        return false;
+    }
+
+    if (!complete)
+    {
+        printf("ERROR: Physics log %s is cut short\n", path.c_str());
+    }
+    return complete;
+}
+
+bool PhysicsLogReader::Read(void* data, size_t size)
+{
+    return fread(data, 1, size, file) == size;
+}
@@ -0,0 +1,133 @@
+#ifndef PHYSICS_RECORDING_H
+#define PHYSICS_RECORDING_H
+
+#include "btBulletDynamicsCommon.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// A physics log is the header followed by every change made to the
+// world, in the order PhysicsManager made them under its world lock.
+// Replaying the entries into a new single threaded world steps it
+// through exactly the same states
+enum PhysicsLogEntryType : uint8_t
+{
+    PHYSICS_LOG_SPAWN,
+    PHYSICS_LOG_IMPULSE,
+    PHYSICS_LOG_REMOVE_ALL,
+    PHYSICS_LOG_STEP,
+    // One body removed, by id
+    PHYSICS_LOG_REMOVE,
+    PHYSICS_LOG_END
+};
+
+// Everything needed to add a body back bit for bit as it was. Only
+// the state Bullet keeps between steps, contact caches aren't saved
+// since recordings start from a freshly built world
+struct PhysicsBodyState
+{
+    // Order of the spawn in the log, impulses refer to bodies by it
+    uint32_t id;
+    // CollisionShapeType
+    uint32_t shapeType;
+    btVector3FloatData halfExtents;
+    float mass;
+    btTransformFloatData transform;
+    btTransformFloatData interpolationTransform;
+    btVector3FloatData linearVelocity;
+    btVector3FloatData angularVelocity;
+    btVector3FloatData interpolationLinearVelocity;
+    btVector3FloatData interpolationAngularVelocity;
+    int32_t activationState;
+    float deactivationTime;
+    // Broadphase filter, the layers the body collides with
+    int32_t collisionGroup;
+    int32_t collisionMask;
+};
+static_assert(std::is_trivially_copyable<PhysicsBodyState>::value, "PhysicsBodyState is written as raw bytes");
+
+struct PhysicsLogEntry
+{
+    PhysicsLogEntryType type = PHYSICS_LOG_END;
+
+    // PHYSICS_LOG_SPAWN, bodies added as one batch. optimize is set
+    // when the broadphase tree was rebuilt after it
+    std::vector<PhysicsBodyState> bodies;
+    bool optimize = false;
+
+    // PHYSICS_LOG_IMPULSE and PHYSICS_LOG_REMOVE
+    uint32_t id = 0;
+    btVector3FloatData impulse;
+
+    // PHYSICS_LOG_STEP, checksum of the world after the step
+    float dt = 0.0f;
+    uint64_t checksum = 0;
+};
+
+// Writes a physics log. Used by PhysicsManager with its world lock held
+class PhysicsRecorder
+{
+public:
+    ~PhysicsRecorder();
+
+    bool Open(const std::string& path, int broadphase);
+    void Close();
+    bool IsOpen() const { return file != nullptr; }
+
+    // Gives the body the next id, for the spawn entry
+    uint32_t AssignId(const btCollisionObject* body);
+    // False for bodies added before the recording started
+    bool FindId(const btCollisionObject* body, uint32_t& id) const;
+
+    void WriteSpawn(const PhysicsBodyState* states, uint32_t count, bool optimize);
+    void WriteImpulse(uint32_t id, const btVector3& impulse);
+    // Nothing for bodies added before the recording started
+    void WriteRemove(const btCollisionObject* body);
+    void WriteRemoveAll();
+    void WriteStep(float dt, uint64_t checksum);
+
+    unsigned long long GetTickCount() const { return ticks; }
+    size_t GetBytesWritten() const { return bytesWritten; }
+
+private:
+    void Write(const void* data, size_t size);
+    template <typename T>
+    void Write(const T& value) { Write(&value, sizeof(T)); }
+
+    FILE* file = nullptr;
+    // Bodies come from pools, so ids are dropped with them on removal
+    std::unordered_map<const btCollisionObject*, uint32_t> ids;
+    uint32_t nextId = 0;
+    unsigned long long ticks = 0;
+    size_t bytesWritten = 0;
+};
+
+class PhysicsLogReader
+{
+public:
+    ~PhysicsLogReader();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    // PhysicsBroadphase the log was recorded with
+    int GetBroadphase() const { return broadphase; }
+
+    // False once the log ends, or when it's cut short
+    bool Next(PhysicsLogEntry& entry);
+
+private:
+    bool Read(void* data, size_t size);
+    template <typename T>
+    bool Read(T& value) { return Read(&value, sizeof(T)); }
+
+    FILE* file = nullptr;
+    std::string path;
+    int broadphase = 0;
+};
+
+#endif // PHYSICS_RECORDING_H
@@ -0,0 +1,140 @@
+#include "PostProcessChain.h"
+
+#include <vector>
+
+void PostProcessChain::Init(int _width, int _height)
+{
+    width = _width;
+    height = _height;
+
+    blurShader = new Shader("../Glitter/Shaders/blur.comp");
+    edgeShader = new Shader("../Glitter/Shaders/edge.comp");
+    resampleShader = new Shader("../Glitter/Shaders/resample.comp");
+
+    for (int i = 0; i < 2; ++i)
+    {
+        fullTargets[i] = CreateTarget(width, height);
+        halfTargets[i] = CreateTarget(width / 2, height / 2);
+    }
+}
+
+Texture PostProcessChain::CreateTarget(int targetWidth, int targetHeight)
+{
+    Texture target;
+    target.width = targetWidth;
+    target.height = targetHeight;
+
+    glGenTextures(1, &target.ID);
+    glBindTexture(GL_TEXTURE_2D, target.ID);
+    // Immutable storage, the format and single mip level never change
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, targetWidth, targetHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return target;
+}
+
+void PostProcessChain::Dispatch(Shader* shader, GLuint input, const Texture& output,
+                                GLuint threadsX, GLuint threadsY, GLuint pointOps, bool isLast)
+{
+    shader->use();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, input);
+    shader->setInt("inputTex", 0);
+    glUniform1ui(glGetUniformLocation(shader->ID, "pointOps"), pointOps);
+
+    glBindImageTexture(0, output.ID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    // The next dispatch samples this image, the last one is read by a blit
+    shader->DispatchThreads(threadsX, threadsY, 1,
+                            isLast ? GL_FRAMEBUFFER_BARRIER_BIT : GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    ++lastDispatchCount;
+}
+
+void PostProcessChain::Run(GLuint input, GLuint output, const PostProcessSettings& settings)
+{
+    lastDispatchCount = 0;
+
+    GLuint pointOps = 0;
+    if (settings.grayscale) { pointOps |= POINT_OP_GRAYSCALE; }
+    if (settings.invert)    { pointOps |= POINT_OP_INVERT; }
+
+    // Build the list of neighbourhood passes, the point ops ride on the last one
+    enum Pass { BLUR_HORIZONTAL, BLUR_VERTICAL, EDGE, RESAMPLE };
+    std::vector<Pass> passes;
+    if (settings.blur)
+    {
+        passes.push_back(BLUR_HORIZONTAL);
+        passes.push_back(BLUR_VERTICAL);
+    }
+    if (settings.edgeFilter != EDGE_NONE)
+    {
+        passes.push_back(EDGE);
+    }
+    // Half resolution needs an upsample at the end, and with no effect
+    // at all a single resample still copies the input to the output
+    if (settings.halfResolution || passes.empty())
+    {
+        passes.push_back(RESAMPLE);
+    }
+
+    Texture finalTarget;
+    finalTarget.ID = output;
+    finalTarget.width = width;
+    finalTarget.height = height;
+
+    // The first pass downsamples for free by sampling the full size
+    // input with normalized coordinates at the half size output
+    Texture* targets = settings.halfResolution ? halfTargets : fullTargets;
+
+    GLuint source = input;
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        bool isLast = (i == passes.size() - 1);
+        const Texture& target = isLast ? finalTarget : targets[i % 2];
+        GLuint ops = isLast ? pointOps : 0;
+
+        switch (passes[i])
+        {
+            case BLUR_HORIZONTAL:
+            case BLUR_VERTICAL:
+            {
+                bool vertical = (passes[i] == BLUR_VERTICAL);
+                blurShader->use();
+                blurShader->setBool("vertical", vertical);
+                // One work group per tile of a row/column
+                GLuint lineLength = vertical ? target.height : target.width;
+                GLuint lineCount  = vertical ? target.width  : target.height;
+                Dispatch(blurShader, source, target, lineLength, lineCount, ops, isLast);
+                break;
+            }
+            case EDGE:
+                edgeShader->use();
+                edgeShader->setInt("kernelType", settings.edgeFilter == EDGE_SOBEL ? 0 : 1);
+                Dispatch(edgeShader, source, target, target.width, target.height, ops, isLast);
+                break;
+            case RESAMPLE:
+                Dispatch(resampleShader, source, target, target.width, target.height, ops, isLast);
+                break;
+        }
+
+        source = target.ID;
+    }
+}
+
+void PostProcessChain::Shutdown()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        glDeleteTextures(1, &fullTargets[i].ID);
+        glDeleteTextures(1, &halfTargets[i].ID);
+    }
+
+    delete blurShader;
+    delete edgeShader;
+    delete resampleShader;
+}
@@ -0,0 +1,48 @@
+#ifndef POST_PROCESS_CHAIN_H
+#define POST_PROCESS_CHAIN_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "Texture.h"
+#include "RenderSettings.h"
+
+// Post-processing as a chain of compute dispatches ping-ponging between
+// RGBA8 images. Neighbourhood effects tile their input in shared memory,
+// the blur is separable, and per-pixel ops (grayscale, invert) are fused
+// into whichever dispatch runs last instead of getting their own pass
+class PostProcessChain
+{
+public:
+    void Init(int width, int height);
+    // Applies the enabled effects to input and writes the result to
+    // output, which must be an RGBA8 texture of the full size
+    void Run(GLuint input, GLuint output, const PostProcessSettings& settings);
+    void Shutdown();
+
+    Shader* blurShader;
+    Shader* edgeShader;
+    Shader* resampleShader;
+
+    // Number of dispatches issued by the last Run, for TentGui
+    int lastDispatchCount = 0;
+
+private:
+    // Bits of pointOps in include/postops.glsl
+    enum PointOps
+    {
+        POINT_OP_GRAYSCALE = 1 << 0,
+        POINT_OP_INVERT    = 1 << 1
+    };
+
+    void Dispatch(Shader* shader, GLuint input, const Texture& output,
+                  GLuint threadsX, GLuint threadsY, GLuint pointOps, bool isLast);
+    Texture CreateTarget(int width, int height);
+
+    int width, height;
+    // Intermediate images at full and half resolution
+    Texture fullTargets[2];
+    Texture halfTargets[2];
+};
+
+#endif // POST_PROCESS_CHAIN_H
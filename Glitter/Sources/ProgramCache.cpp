@@ -0,0 +1,146 @@
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+// Bumped whenever the entry layout changes
+const unsigned int CACHE_MAGIC = 0x54454E31; // "TEN1"
+
+ProgramCache::Stats ProgramCache::stats;
+
+struct CacheHeader
+{
+    unsigned int magic;
+    GLenum binaryFormat;
+    GLint length;
+    double compileMs;
+};
+
+// 64-bit FNV-1a
+static unsigned long long Hash(unsigned long long hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static unsigned long long Hash(unsigned long long hash, const char* string)
+{
+    // Null when there is no current context
+    if (string == nullptr) { return hash; }
+    // Keep the terminator so "ab"+"c" and "a"+"bc" differ
+    return Hash(hash, string, std::char_traits<char>::length(string) + 1);
+}
+
+bool ProgramCache::IsSupported()
+{
+    static GLint numFormats = -1;
+    if (numFormats < 0)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    }
+    return numFormats > 0;
+}
+
+unsigned long long ProgramCache::Key(const std::vector<GLenum>& types,
+                                     const std::vector<std::string>& sources)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = Hash(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = Hash(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hash = Hash(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        hash = Hash(hash, &types[i], sizeof(GLenum));
+        hash = Hash(hash, sources[i].c_str());
+    }
+    return hash;
+}
+
+std::string ProgramCache::EntryPath(unsigned long long key)
+{
+    std::stringstream path;
+    path << SHADER_CACHE_DIR << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return path.str();
+}
+
+GLuint ProgramCache::Load(unsigned long long key)
+{
+    if (!IsSupported()) { return 0; }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    std::ifstream file(EntryPath(key), std::ios::binary);
+    if (!file.is_open()) { return 0; }
+
+    CacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != CACHE_MAGIC || header.length <= 0) { return 0; }
+
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), header.length);
+    if (!file) { return 0; }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), header.length);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // Driver state the key doesn't capture changed, rebuild it
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double loadMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+    ++stats.hits;
+    stats.loadMs += loadMs;
+    stats.compileMsAvoided += header.compileMs;
+    return program;
+}
+
+void ProgramCache::Store(unsigned long long key, GLuint program, double compileMs)
+{
+    ++stats.misses;
+    stats.compileMs += compileMs;
+
+    if (!IsSupported()) { return; }
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.compileMs = compileMs;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &header.length);
+    if (header.length <= 0) { return; }
+
+    std::vector<char> binary(header.length);
+    glGetProgramBinary(program, header.length, NULL, &header.binaryFormat, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIR, error);
+    if (error)
+    {
+        std::cout << "ERROR: Could not create shader cache folder " << SHADER_CACHE_DIR << "\n";
+        return;
+    }
+
+    // Written next to the entry and renamed, so a crash mid-write
+    // never leaves a truncated entry behind
+    std::string path = EntryPath(key);
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), header.length);
+    }
+    std::filesystem::rename(path + ".tmp", path, error);
+}
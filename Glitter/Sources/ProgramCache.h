@@ -0,0 +1,54 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Set by CMake to a folder in the build directory
+#ifndef SHADER_CACHE_DIR
+#define SHADER_CACHE_DIR "ShaderCache"
+#endif
+
+// On-disk cache of linked program binaries (glGetProgramBinary).
+// Entries are keyed by a hash of the preprocessed sources of every stage
+// and the driver's vendor/renderer/version strings, so editing a shader,
+// an include, a feature define or updating the driver all miss the cache.
+// A binary the driver rejects is treated as a miss and rebuilt
+class ProgramCache
+{
+public:
+    struct Stats
+    {
+        int hits = 0;
+        int misses = 0;
+        // Time spent loading binaries on hits
+        double loadMs = 0.0;
+        // Compile + link time the hits would have cost, as measured
+        // when each entry was stored
+        double compileMsAvoided = 0.0;
+        // Compile + link time of misses
+        double compileMs = 0.0;
+    };
+
+    // Hash of the stage types and their expanded sources plus the driver
+    static unsigned long long Key(const std::vector<GLenum>& types,
+                                  const std::vector<std::string>& sources);
+
+    // Creates a program from the cached binary, returns 0 on a miss
+    static GLuint Load(unsigned long long key);
+    // Writes the linked program's binary. compileMs is kept in
+    // the entry to report the time saved by later hits
+    static void Store(unsigned long long key, GLuint program, double compileMs);
+
+    // False when the driver exposes no binary formats
+    static bool IsSupported();
+
+    static Stats stats;
+
+private:
+    static std::string EntryPath(unsigned long long key);
+};
+
+#endif // PROGRAM_CACHE_H
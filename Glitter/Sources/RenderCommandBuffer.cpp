@@ -0,0 +1,74 @@
+#include "RenderCommandBuffer.h"
+
+#include <cstdint>
+
+RenderCommandBuffer::~RenderCommandBuffer()
+{
+    Reset();
+    for (unsigned char* block : blocks)
+    {
+        delete[] block;
+    }
+}
+
+void* RenderCommandBuffer::Allocate(size_t size, size_t alignment)
+{
+    bytesUsed += size;
+
+    // Worst case padding included, so an aligned start always fits
+    if (size + alignment > BLOCK_SIZE)
+    {
+        unsigned char* memory = new unsigned char[size + alignment];
+        largeAllocations.push_back(memory);
+        uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+        return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    }
+
+    while (true)
+    {
+        if (blockIndex == blocks.size())
+        {
+            blocks.push_back(new unsigned char[BLOCK_SIZE]);
+        }
+
+        uintptr_t base = reinterpret_cast<uintptr_t>(blocks[blockIndex]);
+        uintptr_t address = (base + blockOffset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (address + size <= base + BLOCK_SIZE)
+        {
+            blockOffset = address + size - base;
+            return reinterpret_cast<void*>(address);
+        }
+
+        ++blockIndex;
+        blockOffset = 0;
+    }
+}
+
+void RenderCommandBuffer::Execute()
+{
+    for (CommandHeader* command = first; command != nullptr; command = command->next)
+    {
+        command->execute(command->payload);
+    }
+}
+
+void RenderCommandBuffer::Reset()
+{
+    for (CommandHeader* command = first; command != nullptr; command = command->next)
+    {
+        command->destroy(command->payload);
+    }
+    first = nullptr;
+    last = nullptr;
+    commandCount = 0;
+
+    for (unsigned char* memory : largeAllocations)
+    {
+        delete[] memory;
+    }
+    largeAllocations.clear();
+
+    blockIndex = 0;
+    blockOffset = 0;
+    bytesUsed = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef RENDER_COMMAND_BUFFER_H
+#define RENDER_COMMAND_BUFFER_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Commands recorded by the game thread for one frame and executed in the
+// same order by the render thread. Commands and any per-frame data they
+// point to (draw lists, copied uniforms) live in blocks that are reused
+// every frame, so recording a frame doesn't touch the heap once the
+// blocks have grown to the frame's size
+class RenderCommandBuffer
+{
+public:
+    RenderCommandBuffer() {}
+    RenderCommandBuffer(const RenderCommandBuffer&) = delete;
+    RenderCommandBuffer& operator=(const RenderCommandBuffer&) = delete;
+    ~RenderCommandBuffer();
+
+    // Stores a callable to run on the render thread. Whatever it captures
+    // is destroyed on the next Reset, after it ran
+    template <typename F>
+    void Record(F&& command)
+    {
+        typedef typename std::decay<F>::type Command;
+
+        CommandHeader* header = static_cast<CommandHeader*>(Allocate(sizeof(CommandHeader), alignof(CommandHeader)));
+        void* payload = Allocate(sizeof(Command), alignof(Command));
+        new (payload) Command(std::forward<F>(command));
+
+        header->payload = payload;
+        header->execute = [](void* p) { (*static_cast<Command*>(p))(); };
+        header->destroy = [](void* p) { static_cast<Command*>(p)->~Command(); };
+        header->next = nullptr;
+        if (last != nullptr) { last->next = header; } else { first = header; }
+        last = header;
+        ++commandCount;
+    }
+
+    // Memory valid until the next Reset, e.g. for draw lists commands
+    // point to. Nothing is destructed, so only use it for plain data
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "frame memory is never destructed");
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Render thread
+    void Execute();
+    // Game thread, once the render thread is done with the frame
+    void Reset();
+
+    size_t GetCommandCount() const { return commandCount; }
+    size_t GetBytesUsed() const { return bytesUsed; }
+
+private:
+    struct CommandHeader
+    {
+        void* payload;
+        void (*execute)(void*);
+        void (*destroy)(void*);
+        CommandHeader* next;
+    };
+
+    static const size_t BLOCK_SIZE = 256 * 1024;
+
+    std::vector<unsigned char*> blocks;
+    // Allocations that don't fit in a block, freed on Reset
+    std::vector<unsigned char*> largeAllocations;
+    size_t blockIndex = 0;
+    size_t blockOffset = 0;
+    size_t bytesUsed = 0;
+
+    CommandHeader* first = nullptr;
+    CommandHeader* last = nullptr;
+    size_t commandCount = 0;
+};
+
+#endif // RENDER_COMMAND_BUFFER_H
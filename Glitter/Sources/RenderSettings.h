@@ -0,0 +1,67 @@
+#ifndef RENDER_SETTINGS_H
+#define RENDER_SETTINGS_H
+
+#include <atomic>
+#include <cstddef>
+
+enum RenderPath
+{
+    RENDER_PATH_FORWARD,
+    RENDER_PATH_DEFERRED
+};
+
+enum TransparencyMode
+{
+    // Back to front CPU sort, blended over the scene
+    TRANSPARENCY_SORTED,
+    // Weighted blended order-independent transparency
+    TRANSPARENCY_WEIGHTED_OIT
+};
+
+enum EdgeFilter
+{
+    EDGE_NONE,
+    EDGE_SOBEL,
+    EDGE_OUTLINE
+};
+
+struct PostProcessSettings
+{
+    // Compute chain, otherwise the old kernel.frag fullscreen pass
+    bool useCompute = true;
+    bool blur = false;
+    EdgeFilter edgeFilter = EDGE_NONE;
+    bool grayscale = false;
+    bool invert = false;
+    // Run the effects at half resolution and upsample at the end
+    bool halfResolution = false;
+};
+
+// Runtime switches for the render loop, edited through TentGui
+// so different pipelines can be compared on the same scene
+struct RenderSettings
+{
+    RenderPath renderPath = RENDER_PATH_FORWARD;
+    // Lay down opaque depth first so the lighting
+    // pass runs once per visible fragment
+    bool depthPrepass = false;
+    TransparencyMode transparency = TRANSPARENCY_SORTED;
+    PostProcessSettings postProcess;
+    // Record frame N while the render thread draws frame N-1. Off waits
+    // for every frame to be drawn, to compare against single threaded
+    bool pipelinedRendering = true;
+};
+
+// Filled by the render thread, read by TentGui on the game thread
+struct RenderStats
+{
+    // Samples that passed the depth test during the opaque pass,
+    // i.e. how many fragments ran the lighting shader
+    std::atomic<unsigned long long> opaqueSamples{ 0 };
+    std::atomic<int> postProcessDispatches{ 0 };
+    // ShaderController is only touched by the render thread
+    std::atomic<size_t> shaderVariants{ 0 };
+    std::atomic<size_t> pendingShaderBuilds{ 0 };
+};
+
+#endif // RENDER_SETTINGS_H
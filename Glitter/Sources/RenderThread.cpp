@@ -0,0 +1,181 @@
+#include "RenderThread.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "JobSystem.h"
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+template <typename Predicate>
+void RenderThread::WaitUntil(Predicate done)
+{
+    // Handoffs are usually a few microseconds apart, yield before sleeping
+    for (int spin = 0; !done(); ++spin)
+    {
+        if (spin < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+void RenderThread::Start(GLFWwindow* _window)
+{
+    window = _window;
+    stopping = false;
+
+    glfwMakeContextCurrent(nullptr);
+    thread = std::thread(&RenderThread::Loop, this);
+}
+
+void RenderThread::Stop()
+{
+    if (!thread.joinable()) { return; }
+
+    WaitUntil([&] { return executedFrame.load() == submittedFrame.load(); });
+    stopping = true;
+    thread.join();
+
+    glfwMakeContextCurrent(window);
+}
+
+RenderCommandBuffer& RenderThread::BeginFrame()
+{
+    std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+
+    unsigned long long frame = ++recordingFrame;
+    // The buffer was last used by frame - 2
+    WaitUntil([&] { return executedFrame.load() + 2 >= frame; });
+    gameWaitMs += MillisecondsSince(waitStart);
+
+    RenderCommandBuffer& buffer = buffers[frame % 2];
+    buffer.Reset();
+
+    gameFrameStart = std::chrono::steady_clock::now();
+    return buffer;
+}
+
+void RenderThread::Submit(bool pipelined)
+{
+    double gameMs = MillisecondsSince(gameFrameStart);
+    {
+        const RenderCommandBuffer& buffer = buffers[recordingFrame % 2];
+        std::lock_guard<std::mutex> lock(statsMutex);
+        AddTiming(stats.gameMs, gameMs);
+        stats.commandCount = buffer.GetCommandCount();
+        stats.commandBytes = buffer.GetBytesUsed();
+    }
+
+    if (!thread.joinable())
+    {
+        buffers[recordingFrame % 2].Execute();
+        glfwSwapBuffers(window);
+        executedFrame = recordingFrame;
+        submittedFrame = recordingFrame;
+        return;
+    }
+
+    submittedFrame.store(recordingFrame);
+
+    std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+    if (!pipelined)
+    {
+        WaitUntil([&] { return executedFrame.load() == recordingFrame; });
+    }
+    gameWaitMs += MillisecondsSince(waitStart);
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    AddTiming(stats.gameWaitMs, gameWaitMs);
+    gameWaitMs = 0.0;
+}
+
+void RenderThread::RunSync(const std::function<void()>& work)
+{
+    if (!thread.joinable())
+    {
+        work();
+        return;
+    }
+
+    syncWork = &work;
+    syncDone = false;
+    syncRequested = true;
+    WaitUntil([&] { return syncDone.load(); });
+    syncWork = nullptr;
+}
+
+RenderThread::Stats RenderThread::GetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+void RenderThread::AddTiming(double& average, double ms)
+{
+    average = average == 0.0 ? ms : average * 0.95 + ms * 0.05;
+}
+
+void RenderThread::Loop()
+{
+    glfwMakeContextCurrent(window);
+    // GL jobs run here from now on
+    jobSystem.BindGlThread();
+
+    while (true)
+    {
+        std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        WaitUntil([&]
+        {
+            return submittedFrame.load() > executedFrame.load() || syncRequested.load() || stopping.load();
+        });
+        double waitMs = MillisecondsSince(waitStart);
+
+        // Frames submitted before a sync request may still
+        // reference what the request is about to change
+        if (submittedFrame.load() > executedFrame.load())
+        {
+            unsigned long long frame = executedFrame.load() + 1;
+
+            std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+            buffers[frame % 2].Execute();
+            double renderMs = MillisecondsSince(renderStart);
+
+            std::chrono::steady_clock::time_point swapStart = std::chrono::steady_clock::now();
+            glfwSwapBuffers(window);
+            double swapMs = MillisecondsSince(swapStart);
+
+            executedFrame.store(frame);
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            AddTiming(stats.renderWaitMs, waitMs);
+            AddTiming(stats.renderMs, renderMs);
+            AddTiming(stats.swapMs, swapMs);
+            continue;
+        }
+
+        if (syncRequested.load())
+        {
+            (*syncWork)();
+            syncRequested = false;
+            syncDone = true;
+            continue;
+        }
+
+        if (stopping.load()) { break; }
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,89 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "RenderCommandBuffer.h"
+
+struct GLFWwindow;
+
+// Owns the GL context and executes frame N-1's commands while the game
+// thread records frame N. The two command buffers are handed back and
+// forth through frame counters only, neither side takes a lock
+class RenderThread
+{
+public:
+    // Milliseconds per frame, averaged over the last second or so
+    struct Stats
+    {
+        // Game thread recording the frame, without waiting
+        double gameMs = 0.0;
+        // Game thread waiting for the render thread to free a buffer
+        double gameWaitMs = 0.0;
+        // Render thread executing commands
+        double renderMs = 0.0;
+        // Render thread waiting for the next frame
+        double renderWaitMs = 0.0;
+        // glfwSwapBuffers, includes waiting for vsync
+        double swapMs = 0.0;
+        size_t commandCount = 0;
+        size_t commandBytes = 0;
+    };
+
+    ~RenderThread();
+
+    // The window's context must be current on the calling thread, it is
+    // moved to the render thread until Stop
+    void Start(GLFWwindow* window);
+    // Finishes every submitted frame and makes the context current
+    // on the calling thread again
+    void Stop();
+    bool IsRunning() { return thread.joinable(); }
+
+    // Game thread. Returns the buffer to record the next frame into,
+    // waiting until the render thread is done with its previous contents
+    RenderCommandBuffer& BeginFrame();
+    // Hands the frame to the render thread. Without pipelining, waits
+    // until it's on screen, as if everything ran on one thread
+    void Submit(bool pipelined = true);
+
+    // Runs work on the render thread once the submitted frames are done,
+    // and waits for it. For GL resource changes the game thread can't
+    // make itself, e.g. loading a scene. Runs inline when not started
+    void RunSync(const std::function<void()>& work);
+
+    Stats GetStats();
+
+private:
+    void Loop();
+    // Yields, then sleeps, until done returns true
+    template <typename Predicate>
+    static void WaitUntil(Predicate done);
+    void AddTiming(double& average, double ms);
+
+    GLFWwindow* window = nullptr;
+    std::thread thread;
+    std::atomic<bool> stopping{ false };
+
+    RenderCommandBuffer buffers[2];
+    // Frames are numbered from 1, frame N uses buffers[N % 2]
+    unsigned long long recordingFrame = 0;
+    std::atomic<unsigned long long> submittedFrame{ 0 };
+    std::atomic<unsigned long long> executedFrame{ 0 };
+
+    const std::function<void()>* syncWork = nullptr;
+    std::atomic<bool> syncRequested{ false };
+    std::atomic<bool> syncDone{ false };
+
+    std::chrono::steady_clock::time_point gameFrameStart;
+    double gameWaitMs = 0.0;
+
+    std::mutex statsMutex;
+    Stats stats;
+};
+
+#endif // RENDER_THREAD_H
@@ -14,6 +14,7 @@
 #include "Cube.h"
 #include "Quad.h"
 #include "Light.h"
+#include "Model.h"
 #include "ObjectManager.h"
 #include "ShaderController.h"
 #include "Shared.h"
@@ -82,26 +83,117 @@ bool IsValidField(std::string field)
     return true;
 }
 
+// Optional, scenes without layers put everything in "Default".
+// A pair of layers collides if either one lists the other
+static CollisionLayers ParseCollisionLayers(const Value& document)
+{
+    CollisionLayers layers;
+    if (!document.HasMember("CollisionLayers")) { return layers; }
+
+    const Value& layerArray = document["CollisionLayers"];
+    assert(layerArray.IsArray());
+    for (Value::ConstValueIterator itr = layerArray.Begin(); itr != layerArray.End(); ++itr)
+    {
+        const char* name = itr->FindMember("name")->value.GetString();
+        if (layers.Find(name) < 0 && layers.Add(name) < 0)
+        {
+            std::cout << "ERROR: Too many collision layers, ignoring " << name << '\n';
+        }
+    }
+
+    for (int a = 0; a < layers.GetLayerCount(); ++a)
+    {
+        for (int b = 0; b < layers.GetLayerCount(); ++b)
+        {
+            layers.SetCollides(a, b, false);
+        }
+    }
+    for (Value::ConstValueIterator itr = layerArray.Begin(); itr != layerArray.End(); ++itr)
+    {
+        int layer = layers.Find(itr->FindMember("name")->value.GetString());
+        if (layer < 0 || !itr->HasMember("collidesWith")) { continue; }
+
+        const Value& others = itr->FindMember("collidesWith")->value;
+        for (Value::ConstValueIterator other = others.Begin(); other != others.End(); ++other)
+        {
+            int otherLayer = layers.Find(other->GetString());
+            if (otherLayer < 0)
+            {
+                std::cout << "ERROR: Unknown collision layer " << other->GetString() << '\n';
+                continue;
+            }
+            layers.SetCollides(layer, otherLayer, true);
+        }
+    }
+    return layers;
+}
+
 
 void SceneLoader::LoadNewScene(ObjectManager& manager)
 {
     std::cout << "Clearing scene\n";
+    // The simulation may still be moving them
+    shared.physicsManager->RemoveAll();
     for (auto objectPtr : manager.glObjectList)
     {
         delete objectPtr;
     }
     manager.glObjectList.clear();
+    shared.physicsManager->SetCollisionLayers(CollisionLayers());
 
     currentScenePath.clear();
     currentSceneFileName.clear();
 }
 
-void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
+bool SceneLoader::ParseScene(const char* path)
 {
     FILE* fp = fopen(path, "r");
     if (fp == 0)
     {
         std::cout << "ERROR: Failed to load SCENE file: " << path << '\n';
+        parsedScenePath.clear();
+        return false;
+    }
+
+    char readBuffer[65536];
+    FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+
+    parsedScene.ParseStream(is);
+    fclose(fp);
+
+    if (parsedScene.HasParseError() || !parsedScene.IsObject())
+    {
+        std::cout << "ERROR: Failed to parse SCENE file: " << path << '\n';
+        parsedScenePath.clear();
+        return false;
+    }
+
+    parsedScenePath.assign(path);
+    return true;
+}
+
+std::vector<std::string> SceneLoader::GetSceneTextures()
+{
+    std::vector<std::string> textures;
+    if (parsedScenePath.empty() || !parsedScene.HasMember("SceneObjects")) { return textures; }
+
+    const Value& sceneObjects = parsedScene["SceneObjects"];
+    for (Value::ConstValueIterator itr = sceneObjects.Begin(); itr != sceneObjects.End(); ++itr)
+    {
+        if (itr->HasMember("texture"))
+        {
+            textures.push_back(itr->FindMember("texture")->value.GetString());
+        }
+    }
+    return textures;
+}
+
+void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
+{
+    // Already parsed ahead of time, e.g. on a startup worker
+    if (parsedScenePath != path && !ParseScene(path))
+    {
+        return;
     }
 
     currentScenePath.assign(path);
@@ -110,6 +202,8 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
     );
 
     std::cout << "Clearing scene\n";
+    // The simulation may still be moving them
+    shared.physicsManager->RemoveAll();
     for (auto objectPtr : manager.glObjectList)
     {
         delete objectPtr;
@@ -118,18 +212,19 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
 
     std::cout << "Loading SCENE file: " << currentScenePath << '\n';
     std::cout << "Loading SCENE file: " << currentSceneFileName << '\n';
-    char readBuffer[65536];
-    FileReadStream is(fp, readBuffer, sizeof(readBuffer));
 
     Document document;
-    document.ParseStream(is);
+    document.Swap(parsedScene);
+    parsedScenePath.clear();
 
-    assert(document.IsObject());
-
-    fclose(fp);
+    CollisionLayers layers = ParseCollisionLayers(document);
+    shared.physicsManager->SetCollisionLayers(layers);
 
     const Value& sceneObjects = document["SceneObjects"];
     assert(sceneObjects.IsArray());
+    // Bodies are added in one batch once every object is read
+    std::vector<GlObject*> physicsObjects;
+    physicsObjects.reserve(sceneObjects.Size());
     // TODO Lights broken
     for (Value::ConstValueIterator itr = sceneObjects.Begin(); itr != sceneObjects.End(); ++itr)
     {
@@ -143,6 +238,14 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
             case LIGHT:
                        object = new Light();
                        break;
+            case MODEL:
+                       if (!itr->HasMember("model"))
+                       {
+                           std::cout << "ERROR: Loading model object with no model path\n";
+                           continue;
+                       }
+                       object = new Model(itr->FindMember("model")->value.GetString());
+                       break;
 
             case NONE:
                        std::cout << "ERROR: Loading object with no type specified\n";
@@ -158,19 +261,20 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
         {
             const Value& a = itr->FindMember("position")->value;
             assert(a.IsArray());
-            object->position = glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble());
+            object->SetPosition(glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble()));
         }
 
         {
             const Value& a = itr->FindMember("rotation")->value;
             assert(a.IsArray());
-            object->rotation = glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble());
+            // Euler angles in degrees
+            object->SetEulerAngles(glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble()));
         }
 
         {
             const Value& a = itr->FindMember("scale")->value;
             assert(a.IsArray());
-            object->scale = glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble());
+            object->SetScale(glm::vec3(a[0].GetDouble(), a[1].GetDouble(), a[2].GetDouble()));
         }
 
         Texture texture(itr->FindMember("texture")->value.GetString());
@@ -182,6 +286,31 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
         object->isActive = itr->FindMember("isActive")->value.GetBool();
 
         object->isLight = itr->FindMember("isLight")->value.GetBool();
+
+        // Optional, older scene files have no transparency info
+        if (itr->HasMember("isTransparent"))
+        {
+            object->isTransparent = itr->FindMember("isTransparent")->value.GetBool();
+        }
+        if (itr->HasMember("collisionLayer"))
+        {
+            const char* layerName = itr->FindMember("collisionLayer")->value.GetString();
+            object->collisionLayer = layers.Find(layerName);
+            if (object->collisionLayer < 0)
+            {
+                std::cout << "ERROR: Unknown collision layer " << layerName << '\n';
+                object->collisionLayer = 0;
+            }
+        }
+        if (itr->HasMember("isStatic"))
+        {
+            object->isStatic = itr->FindMember("isStatic")->value.GetBool();
+        }
+        if (object->type == MODEL)
+        {
+            Model* model = static_cast<Model*>(object);
+            model->collision = shared.physicsManager->CookCollision(model->path, model->GetCollisionParts());
+        }
         // TODO find a more manageable way of loading this?
         if (object->isLight)
         {
@@ -204,9 +333,10 @@ void SceneLoader::LoadScene(ObjectManager& manager, const char* path)
         // TODO dont add lights yet since
         // scene file does not have light information
         //if (!object->isLight)
-        shared.physicsManager->AddObject(object);
+        physicsObjects.push_back(object);
         manager.Add(object);
     }
+    shared.physicsManager->AddObjects(physicsObjects);
 }
 
 void SceneLoader::SaveCurrentScene(ObjectManager& manager)
@@ -233,6 +363,26 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
     Value myArray(kArrayType);
     Document::AllocatorType& allocator = doc.GetAllocator();
 
+    CollisionLayers layers = shared.physicsManager->GetCollisionLayers();
+    Value layerArray(kArrayType);
+    for (int a = 0; a < layers.GetLayerCount(); ++a)
+    {
+        Value layerValue;
+        layerValue.SetObject();
+        Value name(layers.GetName(a).c_str(), allocator);
+        layerValue.AddMember("name", name, allocator);
+
+        Value collidesWith(kArrayType);
+        for (int b = 0; b < layers.GetLayerCount(); ++b)
+        {
+            if (!layers.Collides(a, b)) { continue; }
+            Value other(layers.GetName(b).c_str(), allocator);
+            collidesWith.PushBack(other, allocator);
+        }
+        layerValue.AddMember("collidesWith", collidesWith, allocator);
+        layerArray.PushBack(layerValue, allocator);
+    }
+
     for (const auto object : manager.glObjectList)
     {
         Value objValue;
@@ -256,11 +406,21 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
 
         objValue.AddMember("tag", tag, allocator);
 
+        if (object->type == MODEL)
+        {
+            Value model(static_cast<Model*>(object)->path.c_str(), allocator);
+            objValue.AddMember("model", model, allocator);
+        }
+
+
+        glm::vec3 objectPosition = object->GetPosition();
+        glm::vec3 objectRotation = object->GetEulerAngles();
+        glm::vec3 objectScale = object->GetScale();
 
         Value position(kArrayType);
         for (int i = 0; i < 3; ++i)
         {
-            position.PushBack(Value().SetDouble(object->position[i]), allocator);
+            position.PushBack(Value().SetDouble(objectPosition[i]), allocator);
         }
         objValue.AddMember("position", position, allocator);
 
@@ -268,7 +428,7 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
         Value rotation(kArrayType);
         for (int i = 0; i < 3; ++i)
         {
-            rotation.PushBack(Value().SetDouble(object->rotation[i]), allocator);
+            rotation.PushBack(Value().SetDouble(objectRotation[i]), allocator);
         }
         objValue.AddMember("rotation", rotation, allocator);
 
@@ -276,7 +436,7 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
         Value scale(kArrayType);
         for (int i = 0; i < 3; ++i)
         {
-            scale.PushBack(Value().SetDouble(object->scale[i]), allocator);
+            scale.PushBack(Value().SetDouble(objectScale[i]), allocator);
         }
         objValue.AddMember("scale", scale, allocator);
 
@@ -289,6 +449,14 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
 
         objValue.AddMember("isLight", object->isLight, allocator);
 
+        objValue.AddMember("isTransparent", object->isTransparent, allocator);
+
+        int layer = object->collisionLayer < layers.GetLayerCount() ? object->collisionLayer : 0;
+        Value collisionLayer(layers.GetName(layer).c_str(), allocator);
+        objValue.AddMember("collisionLayer", collisionLayer, allocator);
+
+        objValue.AddMember("isStatic", object->isStatic, allocator);
+
         if (object->isLight)
         {
             Light* light = static_cast<Light*>(object);
@@ -307,6 +475,7 @@ void SceneLoader::SaveScene(ObjectManager& manager, const char* path)
         myArray.PushBack(objValue, allocator);
     }
 
+    doc.AddMember("CollisionLayers", layerArray, allocator);
     doc.AddMember("SceneObjects", myArray, allocator);
 
     StringBuffer buffer;
@@ -1,8 +1,13 @@
 #ifndef SCENE_LOADER_H
 #define SCENE_LOADER_H
 
+#include <string>
+#include <vector>
+
 #include "ObjectManager.h"
 
+#include "rapidjson/document.h"
+
 class SceneLoader
 {
 public:
@@ -11,6 +16,12 @@ public:
     // Either switch to references or pointers
     void LoadNewScene(ObjectManager&);
     void LoadScene(ObjectManager&, const char*);
+    // Reads and parses a scene file without creating anything, so it
+    // can run on a worker thread. The next LoadScene of the same path
+    // uses the parsed document instead of reading the file again
+    bool ParseScene(const char*);
+    // Texture files referenced by the parsed scene, to decode ahead of time
+    std::vector<std::string> GetSceneTextures();
     void SaveScene(ObjectManager&, const char*);
     void SaveCurrentScene(ObjectManager&);
 
@@ -24,6 +35,9 @@ public:
 private:
     std::string currentScenePath;
     std::string currentSceneFileName;
+
+    std::string parsedScenePath;
+    rapidjson::Document parsedScene;
 };
 
 #endif // SCENE_LOADER_H
@@ -7,6 +7,23 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "ShaderSource.h"
+#include "ProgramCache.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// One stage of a program, e.g. { GL_GEOMETRY_SHADER, "../Glitter/Shaders/x.geom" }
+struct ShaderStage
+{
+    GLenum type;
+    std::string path;
+};
 
 class Shader
 {
@@ -18,63 +35,244 @@ public:
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
+        : Shader({ { GL_VERTEX_SHADER, vertexPath }, { GL_FRAGMENT_SHADER, fragmentPath } })
+    {
+    }
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
+        : Shader({ { GL_VERTEX_SHADER,   vertexPath },
+                   { GL_GEOMETRY_SHADER, geometryPath },
+                   { GL_FRAGMENT_SHADER, fragmentPath } })
+    {
+    }
+    // compute-only program, e.g. for post-processing dispatches
+    // ------------------------------------------------------------------------
+    Shader(const char* computePath)
+        : Shader({ { GL_COMPUTE_SHADER, computePath } })
+    {
+    }
+    // Any set of stages, one file per stage. Every stage is run through
+    // ShaderSource with the given defines, so the same files can be built
+    // into specialized variants (see ShaderController::GetVariant).
+    // Linked programs are loaded from ProgramCache when possible
+    // ------------------------------------------------------------------------
+    Shader(const std::vector<ShaderStage>& _stages, const std::vector<std::string>& _defines = {})
+    {
+        stages = _stages;
+        defines = _defines;
+
+        ProgramBuild build = BeginBuild(true);
+        if (Batch().active)
+        {
+            // Finished by EndBatch, the object must not move until then
+            ID = 0;
+            Batch().pending.push_back({ this, build });
+            return;
+        }
+        FinishBuild(build);
+        ID = build.program;
+        dependencies = build.dependencies;
+    }
+
+    // Between BeginBatch and EndBatch the constructors above only submit
+    // compile + link, EndBatch then reads every result. Drivers with
+    // GL_KHR_parallel_shader_compile compile the whole batch concurrently
+    // instead of one program after another
+    // ------------------------------------------------------------------------
+    static void BeginBatch()
+    {
+        Batch().active = true;
+    }
+    // ------------------------------------------------------------------------
+    static void EndBatch()
+    {
+        ShaderBatch& batch = Batch();
+        for (auto& pending : batch.pending)
+        {
+            Shader* shader = pending.first;
+            ProgramBuild& build = pending.second;
+            shader->FinishBuild(build);
+            shader->ID = build.program;
+            shader->dependencies = build.dependencies;
+        }
+        batch.pending.clear();
+        batch.active = false;
+    }
+
+    // A program being built from this shader's stages. With
+    // GL_KHR_parallel_shader_compile the driver compiles it in the
+    // background until FinishBuild asks for the results
+    // ------------------------------------------------------------------------
+    struct ProgramBuild
+    {
+        GLuint program = 0;
+        std::vector<GLuint> shaders;
+        std::vector<GLenum> types;
+        // Files read per stage, index matches the #line source numbers
+        std::vector<std::vector<std::string>> stageFiles;
+        std::vector<std::string> dependencies;
+        unsigned long long cacheKey = 0;
+        bool fromCache = false;
+        bool blocking = true;
+        std::chrono::high_resolution_clock::time_point start;
+        // When IsBuildReady first saw the build done. Async builds are
+        // polled once a frame, so their compile time is rounded up to
+        // that poll rather than including the wait until FinishBuild
+        std::chrono::high_resolution_clock::time_point ready;
+        bool isReady = false;
+    };
+
+    // Reads the sources and submits compile + link without querying any
+    // status, so the call doesn't wait on the compiler
+    // ------------------------------------------------------------------------
+    ProgramBuild BeginBuild(bool blocking) const
     {
-        vertexName = std::string(vertexPath);
-        fragName = std::string(fragmentPath);
-
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure e)
-        {
-            // TODO Add an error shader in case something doesnt compile?
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        ProgramBuild build;
+        build.blocking = blocking;
+
+        // 1. retrieve the source code with includes expanded
+        std::vector<std::string> sources;
+        build.stageFiles.resize(stages.size());
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            build.types.push_back(stages[i].type);
+            sources.push_back(ShaderSource::Load(stages[i].path, defines, build.stageFiles[i]));
+            for (const std::string& file : build.stageFiles[i])
+            {
+                if (std::find(build.dependencies.begin(), build.dependencies.end(), file) == build.dependencies.end())
+                {
+                    build.dependencies.push_back(file);
+                }
+            }
+        }
+
+        // 2. skip compiling if the driver already gave us this program
+        build.cacheKey = ProgramCache::Key(build.types, sources);
+        build.program = ProgramCache::Load(build.cacheKey);
+        if (build.program != 0)
+        {
+            build.fromCache = true;
+            return build;
+        }
+
+        build.start = std::chrono::high_resolution_clock::now();
+
+        // 3. compile shaders
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            const char* shaderCode = sources[i].c_str();
+            unsigned int shader = glCreateShader(build.types[i]);
+            glShaderSource(shader, 1, &shaderCode, NULL);
+            glCompileShader(shader);
+            build.shaders.push_back(shader);
+        }
+
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        build.program = glCreateProgram();
+        for (unsigned int shader : build.shaders)
+        {
+            glAttachShader(build.program, shader);
+        }
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(build.program);
+        return build;
+    }
+
+    // True once FinishBuild would not stall
+    // ------------------------------------------------------------------------
+    static bool IsBuildReady(ProgramBuild& build)
+    {
+        if (build.fromCache || !SupportsParallelCompile()) { return true; }
+
+        GLint done = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+        if (done == GL_TRUE && !build.isReady)
+        {
+            build.isReady = true;
+            build.ready = std::chrono::high_resolution_clock::now();
+        }
+        return done == GL_TRUE;
+    }
+
+    // Reports errors and frees the stage objects. On failure the
+    // program is deleted and build.program is 0
+    // ------------------------------------------------------------------------
+    bool FinishBuild(ProgramBuild& build)
+    {
+        if (build.fromCache) { return true; }
+
+        for (size_t i = 0; i < build.shaders.size(); ++i)
+        {
+            if (!checkCompileErrors(build.shaders[i], StageName(build.types[i])))
+            {
+                // Error lines are reported as source(line), with source
+                // being the file's index as numbered by the #line directives
+                for (size_t j = 0; j < build.stageFiles[i].size(); ++j)
+                {
+                    std::cout << "  " << j << ": " << build.stageFiles[i][j] << "\n";
+                }
+            }
+        }
+        bool linked = checkCompileErrors(build.program, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        for (unsigned int shader : build.shaders)
+        {
+            glDeleteShader(shader);
+        }
+        build.shaders.clear();
+
+        if (!linked)
+        {
+            glDeleteProgram(build.program);
+            build.program = 0;
+            return false;
+        }
+
+        // Blocking builds, and async ones without parallel compile, were
+        // waited on right here
+        std::chrono::high_resolution_clock::time_point end =
+            build.isReady ? build.ready : std::chrono::high_resolution_clock::now();
+        double compileMs = std::chrono::duration<double, std::milli>(end - build.start).count();
+        ProgramCache::Store(build.cacheKey, build.program, compileMs);
+        return true;
     }
+
+    // Replaces the program with a successfully finished build and frees
+    // the old one. Callers swap between frames, so no draw sees a half
+    // updated shader
+    // ------------------------------------------------------------------------
+    void SwapProgram(ProgramBuild& build)
+    {
+        if (ID != 0) { glDeleteProgram(ID); }
+        ID = build.program;
+        dependencies = build.dependencies;
+        // The new program may reuse the old name with another local size
+        localSizeProgram = 0;
+        build.program = 0;
+    }
+
+    // ------------------------------------------------------------------------
+    static bool SupportsParallelCompile()
+    {
+        static int supported = -1;
+        if (supported < 0)
+        {
+            supported = 0;
+            GLint numExtensions = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+            for (GLint i = 0; i < numExtensions; ++i)
+            {
+                const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (name && std::string(name) == "GL_KHR_parallel_shader_compile")
+                {
+                    supported = 1;
+                    break;
+                }
+            }
+        }
+        return supported == 1;
+    }
+
     // activate the shader
     // ------------------------------------------------------------------------
     void use()
@@ -97,14 +295,98 @@ public:
     {
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
     }
+    // ------------------------------------------------------------------------
+    void setMat4(const std::string &name, const float* value) const
+    {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, value);
+    }
+
+    // ------------------------------------------------------------------------
+    bool IsCompute() const
+    {
+        return stages.size() == 1 && stages[0].type == GL_COMPUTE_SHADER;
+    }
+    // Dispatches the given number of work groups, then issues a barrier for
+    // how the results are read next, e.g. GL_TEXTURE_FETCH_BARRIER_BIT when a
+    // later pass samples the written image. Pass 0 when nothing reads it
+    // before the next dispatch's own barrier, barriers are not free
+    // ------------------------------------------------------------------------
+    void Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ, GLbitfield barriers)
+    {
+        use();
+        glDispatchCompute(groupsX, groupsY, groupsZ);
+        if (barriers != 0)
+        {
+            glMemoryBarrier(barriers);
+        }
+    }
+    // Same, but sized in invocations, rounded up to whole work groups
+    // of the program's local_size
+    // ------------------------------------------------------------------------
+    void DispatchThreads(GLuint width, GLuint height, GLuint depth, GLbitfield barriers)
+    {
+        if (localSizeProgram != ID)
+        {
+            // Cached per program so it is re-read after a hot reload
+            glGetProgramiv(ID, GL_COMPUTE_WORK_GROUP_SIZE, localSize);
+            localSizeProgram = ID;
+        }
+        Dispatch((width  + localSize[0] - 1) / localSize[0],
+                 (height + localSize[1] - 1) / localSize[1],
+                 (depth  + localSize[2] - 1) / localSize[2],
+                 barriers);
+    }
 
-    std::string vertexName;
-    std::string fragName;
+    std::vector<ShaderStage> stages;
+    // Feature defines this program was specialized with
+    std::vector<std::string> defines;
+    // Every file read to build the program, includes too
+    std::vector<std::string> dependencies;
 
 private:
+    struct ShaderBatch
+    {
+        bool active = false;
+        std::vector<std::pair<Shader*, ProgramBuild>> pending;
+    };
+
+    static ShaderBatch& Batch()
+    {
+        static ShaderBatch batch;
+        return batch;
+    }
+
+    GLint localSize[3] = { 1, 1, 1 };
+    unsigned int localSizeProgram = 0;
+
+    std::string SourceNames() const
+    {
+        std::string names;
+        for (const ShaderStage& stage : stages)
+        {
+            if (!names.empty()) { names += ", "; }
+            names += stage.path;
+        }
+        return names;
+    }
+
+    static std::string StageName(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_VERTEX_SHADER:          return "VERTEX";
+            case GL_TESS_CONTROL_SHADER:    return "TESS_CONTROL";
+            case GL_TESS_EVALUATION_SHADER: return "TESS_EVALUATION";
+            case GL_GEOMETRY_SHADER:        return "GEOMETRY";
+            case GL_FRAGMENT_SHADER:        return "FRAGMENT";
+            case GL_COMPUTE_SHADER:         return "COMPUTE";
+            default:                        return "UNKNOWN";
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type)
+    bool checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
         char infoLog[1024];
@@ -114,7 +396,7 @@ private:
             if (!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "(" << vertexName << ", " << fragName << "): " << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::cout << "(" << SourceNames() << "): " << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
         else
@@ -123,9 +405,10 @@ private:
             if (!success)
             {
                 glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "(" << vertexName << ", " << fragName << "): " << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::cout << "(" << SourceNames() << "): " << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 
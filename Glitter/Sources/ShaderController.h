@@ -2,28 +2,119 @@
 #define SHADER_CONTROLLER_H
 
 #include <map>
+#include <unordered_map>
+#include <algorithm>
 
 #include "Shader.h"
+#include "ShaderSource.h"
+#include "ShaderWatcher.h"
 
 class ShaderController;
 
 extern ShaderController shaderController;
 
+// Feature bits a variant is specialized for, each one becomes a
+// #define of the same name (without the prefix) in every stage
+enum ShaderFeature
+{
+    SHADER_FEATURE_NONE         = 0,
+    // Discard texels with (almost) zero alpha
+    SHADER_FEATURE_ALPHA_TEST   = 1 << 0,
+    // Fullscreen kernels used by screen.frag
+    SHADER_FEATURE_BLUR         = 1 << 1,
+    SHADER_FEATURE_EDGE_SOBEL   = 1 << 2,
+    SHADER_FEATURE_EDGE_OUTLINE = 1 << 3,
+    SHADER_FEATURE_GRAYSCALE    = 1 << 4,
+    SHADER_FEATURE_INVERT       = 1 << 5,
+
+    SHADER_FEATURE_COUNT        = 6
+};
+
 class ShaderController
 {
 public:
+    ~ShaderController()
+    {
+        for (auto pair : compiledVariants)
+        {
+            delete pair.second;
+        }
+    }
+
+    // Rebuilds every program, e.g. after switching branches
     void ReloadShaders()
     {
         std::cout << "Reloading Shader\n";
-        for (auto pair : shaderMap)
+        // Includes may have changed too
+        ShaderSource::ClearCache();
+        for (Shader* shader : AllShaders())
         {
-            // TODO Check that there was a change made to the file before reloading it
-            Shader* shader = pair.second;
-            Shader newShader(shader->vertexName.c_str(), shader->fragName.c_str());
-            pair.second->ID = newShader.ID;
+            StartRebuild(shader);
         }
     }
 
+    // Watches a shader folder, programs are rebuilt
+    // by Update when any file they read changes
+    void Watch(const std::string& directory)
+    {
+        watcher.Watch(directory);
+    }
+
+    // Called once per frame. Starts rebuilds for programs depending on
+    // changed files and swaps in the ones that finished linking. With
+    // GL_KHR_parallel_shader_compile nothing here waits on the compiler
+    void Update()
+    {
+        std::vector<std::string> changedFiles = watcher.Poll();
+        if (!changedFiles.empty())
+        {
+            for (const std::string& file : changedFiles)
+            {
+                ShaderSource::Invalidate(file);
+            }
+
+            for (Shader* shader : AllShaders())
+            {
+                for (const std::string& file : changedFiles)
+                {
+                    const std::vector<std::string>& deps = shader->dependencies;
+                    if (std::find(deps.begin(), deps.end(), file) != deps.end())
+                    {
+                        StartRebuild(shader);
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (auto it = pendingBuilds.begin(); it != pendingBuilds.end(); )
+        {
+            Shader* shader = it->first;
+            Shader::ProgramBuild& build = it->second;
+            if (!Shader::IsBuildReady(build))
+            {
+                ++it;
+                continue;
+            }
+
+            if (shader->FinishBuild(build))
+            {
+                shader->SwapProgram(build);
+                std::cout << "Reloaded " << shader->stages[0].path << (shader->stages.size() > 1 ? ", ..." : "") << "\n";
+            }
+            else
+            {
+                // Keep drawing with the last working program. Still pick up
+                // new includes so fixing one of them triggers a rebuild
+                shader->dependencies = build.dependencies;
+            }
+            it = pendingBuilds.erase(it);
+        }
+    }
+
+    // For TentGui
+    size_t GetPendingBuildCount() { return pendingBuilds.size(); }
+
     void Add(std::string tag, Shader* shader)
     {
         shaderMap.insert(std::pair<std::string, Shader*>(tag, shader));
@@ -39,12 +130,132 @@ public:
         else
         {
             std::cout << "ERROR: " << tag << " Shader is not found\n";
+            return nullptr;
         }
     }
 
+    // Returns base built with the given ShaderFeature bits defined,
+    // compiling it the first time that combination is asked for.
+    // Variants with the same stages and defines are only built once,
+    // whichever base they were requested through
+    Shader* GetVariant(Shader* base, unsigned int features)
+    {
+        if (features == SHADER_FEATURE_NONE || base == nullptr) { return base; }
+
+        // Fast path, hit on every draw after the first
+        VariantKey key = { base, features };
+        auto it = variantMap.find(key);
+        if (it != variantMap.end())
+        {
+            return it->second;
+        }
+
+        std::vector<std::string> defines = base->defines;
+        for (int i = 0; i < SHADER_FEATURE_COUNT; ++i)
+        {
+            if (features & (1u << i))
+            {
+                defines.push_back(featureNames[i]);
+            }
+        }
+
+        std::string sourceKey;
+        for (const ShaderStage& stage : base->stages)
+        {
+            sourceKey += std::to_string(stage.type) + ":" + stage.path + ";";
+        }
+        for (const std::string& define : defines)
+        {
+            sourceKey += define + ";";
+        }
+
+        Shader*& variant = compiledVariants[sourceKey];
+        if (variant == nullptr)
+        {
+            variant = new Shader(base->stages, defines);
+        }
+        variantMap[key] = variant;
+        return variant;
+    }
+
+    Shader* GetVariant(std::string tag, unsigned int features)
+    {
+        return GetVariant(Get(tag), features);
+    }
+
+    // For TentGui
+    size_t GetVariantCount() { return compiledVariants.size(); }
 
 private:
+    // A newer edit supersedes a build still in flight
+    void StartRebuild(Shader* shader)
+    {
+        auto pending = pendingBuilds.find(shader);
+        if (pending != pendingBuilds.end())
+        {
+            for (GLuint stage : pending->second.shaders)
+            {
+                glDeleteShader(stage);
+            }
+            glDeleteProgram(pending->second.program);
+            pendingBuilds.erase(pending);
+        }
+        pendingBuilds.emplace(shader, shader->BeginBuild(false));
+    }
+
+    std::vector<Shader*> AllShaders()
+    {
+        std::vector<Shader*> shaders;
+        for (auto pair : shaderMap)
+        {
+            if (std::find(shaders.begin(), shaders.end(), pair.second) == shaders.end())
+            {
+                shaders.push_back(pair.second);
+            }
+        }
+        for (auto pair : compiledVariants)
+        {
+            shaders.push_back(pair.second);
+        }
+        return shaders;
+    }
+
+    struct VariantKey
+    {
+        Shader* base;
+        unsigned int features;
+
+        bool operator==(const VariantKey& other) const
+        {
+            return base == other.base && features == other.features;
+        }
+    };
+
+    struct VariantKeyHash
+    {
+        size_t operator()(const VariantKey& key) const
+        {
+            return std::hash<Shader*>()(key.base) ^ (std::hash<unsigned int>()(key.features) << 1);
+        }
+    };
+
+    // Indexed by ShaderFeature bit
+    const char* featureNames[SHADER_FEATURE_COUNT] = {
+        "ALPHA_TEST",
+        "BLUR",
+        "EDGE_SOBEL",
+        "EDGE_OUTLINE",
+        "GRAYSCALE",
+        "INVERT"
+    };
+
     std::map<std::string, Shader*> shaderMap;
+    std::unordered_map<VariantKey, Shader*, VariantKeyHash> variantMap;
+    // Owned, keyed by stages + defines
+    std::unordered_map<std::string, Shader*> compiledVariants;
+
+    ShaderWatcher watcher;
+    std::unordered_map<Shader*, Shader::ProgramBuild> pendingBuilds;
 };
 
 #endif // SHADER_CONTROLLER_H
@@ -0,0 +1,137 @@
+#include "ShaderSource.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+// Guards against include cycles the once-only rule misses
+const int MAX_INCLUDE_DEPTH = 16;
+
+std::unordered_map<std::string, std::string> ShaderSource::fileCache;
+
+static std::string Directory(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+const std::string* ShaderSource::Read(const std::string& path)
+{
+    auto it = fileCache.find(path);
+    if (it != fileCache.end())
+    {
+        return &it->second;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "(" << path << "): ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        return nullptr;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+
+    return &fileCache.emplace(path, stream.str()).first->second;
+}
+
+std::string ShaderSource::Normalize(const std::string& path)
+{
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+std::string ShaderSource::Load(const std::string& path,
+                               const std::vector<std::string>& defines,
+                               std::vector<std::string>& dependencies)
+{
+    dependencies.clear();
+
+    std::string body;
+    if (!Expand(Normalize(path), body, dependencies, 0))
+    {
+        return "";
+    }
+
+    // #version has to stay the first statement, defines go right after it
+    std::string version;
+    if (body.compare(0, 8, "#version") == 0)
+    {
+        size_t end = body.find('\n');
+        version = body.substr(0, end + 1);
+        body = body.substr(end + 1);
+    }
+
+    std::string source = version;
+    for (const std::string& define : defines)
+    {
+        source += "#define " + define + "\n";
+    }
+    source += version.empty() ? "#line 1 0\n" : "#line 2 0\n";
+    source += body;
+    return source;
+}
+
+bool ShaderSource::Expand(const std::string& path, std::string& out,
+                          std::vector<std::string>& dependencies, int depth)
+{
+    if (depth > MAX_INCLUDE_DEPTH)
+    {
+        std::cout << "(" << path << "): ERROR::SHADER::INCLUDE_TOO_DEEP" << std::endl;
+        return false;
+    }
+
+    const std::string* file = Read(path);
+    if (!file) { return false; }
+
+    int sourceIndex = dependencies.size();
+    dependencies.push_back(path);
+
+    std::istringstream lines(*file);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        ++lineNumber;
+
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        {
+            out += line + "\n";
+            continue;
+        }
+
+        size_t open = line.find('"', start);
+        size_t close = line.find('"', open + 1);
+        if (open == std::string::npos || close == std::string::npos)
+        {
+            std::cout << "(" << path << ":" << lineNumber << "): ERROR::SHADER::BAD_INCLUDE" << std::endl;
+            return false;
+        }
+        std::string includePath = Normalize(Directory(path) + line.substr(open + 1, close - open - 1));
+
+        // Each file is pasted once per program, like #pragma once
+        if (std::find(dependencies.begin(), dependencies.end(), includePath) == dependencies.end())
+        {
+            out += "#line 1 " + std::to_string(dependencies.size()) + "\n";
+            if (!Expand(includePath, out, dependencies, depth + 1))
+            {
+                return false;
+            }
+        }
+        out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+    }
+
+    return true;
+}
+
+void ShaderSource::ClearCache()
+{
+    fileCache.clear();
+}
+
+void ShaderSource::Invalidate(const std::string& path)
+{
+    fileCache.erase(Normalize(path));
+}
@@ -0,0 +1,41 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Minimal GLSL preprocessor run before handing sources to the driver.
+// Expands #include "file" (relative to the including file, each file
+// pasted once) and injects #define lines right after #version, so one
+// file can be compiled into several specialized variants.
+// Expanded files get a #line directive whose source number is their
+// index in the dependency list, so driver errors can be traced back
+class ShaderSource
+{
+public:
+    // Returns the expanded source for path. dependencies receives every
+    // file read (normalized), path itself first
+    static std::string Load(const std::string& path,
+                            const std::vector<std::string>& defines,
+                            std::vector<std::string>& dependencies);
+
+    // Raw file contents are cached since the same includes are read by
+    // many programs and variants. Must be cleared before a hot reload
+    static void ClearCache();
+    // Drops a single file, e.g. after the watcher saw it change
+    static void Invalidate(const std::string& path);
+
+    // Lexically normalized, '/' separated form used for cache
+    // keys and dependency lists, so paths can be compared
+    static std::string Normalize(const std::string& path);
+
+private:
+    static bool Expand(const std::string& path, std::string& out,
+                       std::vector<std::string>& dependencies, int depth);
+    static const std::string* Read(const std::string& path);
+
+    static std::unordered_map<std::string, std::string> fileCache;
+};
+
+#endif // SHADER_SOURCE_H
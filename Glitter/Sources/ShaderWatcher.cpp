@@ -0,0 +1,128 @@
+#include "ShaderWatcher.h"
+#include "ShaderSource.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0) { close(inotifyFd); }
+#endif
+}
+
+void ShaderWatcher::Watch(const std::string& directory)
+{
+    std::vector<std::string> directories = { directory };
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (entry.is_directory())
+        {
+            directories.push_back(entry.path().string());
+        }
+    }
+    if (error)
+    {
+        std::cout << "ERROR: Could not watch shader folder " << directory << "\n";
+        return;
+    }
+
+#ifdef __linux__
+    if (inotifyFd < 0)
+    {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            std::cout << "ERROR: inotify_init1 failed, shader hot reload disabled\n";
+            return;
+        }
+    }
+
+    for (const std::string& dir : directories)
+    {
+        // Editors either write in place or save to a temp file and rename it
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+        {
+            std::cout << "ERROR: Could not watch " << dir << "\n";
+            continue;
+        }
+        watchedDirectories[wd] = dir;
+    }
+#else
+    for (const std::string& dir : directories)
+    {
+        watchedDirectories.push_back(dir);
+        for (const auto& entry : std::filesystem::directory_iterator(dir, error))
+        {
+            if (entry.is_regular_file())
+            {
+                writeTimes[ShaderSource::Normalize(entry.path().string())] = entry.last_write_time();
+            }
+        }
+    }
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::Poll()
+{
+    std::vector<std::string> changed;
+
+#ifdef __linux__
+    if (inotifyFd < 0) { return changed; }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        // EAGAIN, nothing left to read
+        if (length <= 0) { break; }
+
+        for (char* ptr = buffer; ptr < buffer + length; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            auto dir = watchedDirectories.find(event->wd);
+            if (event->len > 0 && dir != watchedDirectories.end())
+            {
+                std::string path = ShaderSource::Normalize(dir->second + "/" + event->name);
+                if (std::find(changed.begin(), changed.end(), path) == changed.end())
+                {
+                    changed.push_back(path);
+                }
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+#else
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - lastPoll < std::chrono::milliseconds(500)) { return changed; }
+    lastPoll = now;
+
+    std::error_code error;
+    for (const std::string& dir : watchedDirectories)
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(dir, error))
+        {
+            if (!entry.is_regular_file()) { continue; }
+
+            std::string path = ShaderSource::Normalize(entry.path().string());
+            std::filesystem::file_time_type writeTime = entry.last_write_time();
+            auto it = writeTimes.find(path);
+            if (it == writeTimes.end() || it->second != writeTime)
+            {
+                writeTimes[path] = writeTime;
+                changed.push_back(path);
+            }
+        }
+    }
+#endif
+
+    return changed;
+}
@@ -0,0 +1,36 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <filesystem>
+#include <chrono>
+
+// Reports shader files that were written since the last Poll.
+// Uses inotify on Linux, elsewhere it falls back to comparing
+// modification times of the files in the watched folders
+class ShaderWatcher
+{
+public:
+    ~ShaderWatcher();
+
+    // Watches directory and its sub-directories (e.g. include/)
+    void Watch(const std::string& directory);
+    // Never blocks. Paths are ShaderSource::Normalize'd
+    std::vector<std::string> Poll();
+
+private:
+#ifdef __linux__
+    int inotifyFd = -1;
+    // Watch descriptor -> directory
+    std::map<int, std::string> watchedDirectories;
+#else
+    std::vector<std::string> watchedDirectories;
+    std::map<std::string, std::filesystem::file_time_type> writeTimes;
+    // Scanning the folders every frame would be wasteful
+    std::chrono::steady_clock::time_point lastPoll;
+#endif
+};
+
+#endif // SHADER_WATCHER_H
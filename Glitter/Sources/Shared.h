@@ -6,6 +6,9 @@
 #include "SceneLoader.h"
 #include "Camera.h"
 #include "PhysicsManager.h"
+#include "RenderSettings.h"
+#include "JobSystem.h"
+#include "RenderThread.h"
 
 #include <vector>
 
@@ -15,6 +18,9 @@ struct Shared
     ShaderController* shaderController;
     SceneLoader* sceneLoader;
     PhysicsManager* physicsManager;
+    RenderSettings* renderSettings;
+    JobSystem* jobSystem;
+    RenderThread* renderThread;
 
     std::vector<Camera> cameras;
 };
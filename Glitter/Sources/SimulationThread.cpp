@@ -0,0 +1,133 @@
+#include "SimulationThread.h"
+
+#include <algorithm>
+
+#include "GlObject.h"
+#include "PhysicsManager.h"
+
+// Ticks run back to back to catch up after a stall before the
+// simulation gives up and drops the rest (spiral of death)
+static const int MAX_CATCH_UP_TICKS = 5;
+
+SimulationThread::~SimulationThread()
+{
+    Stop();
+}
+
+void SimulationThread::AddTickHandler(std::function<void(float dt)> handler)
+{
+    tickHandlers.push_back(std::move(handler));
+}
+
+void SimulationThread::Start(PhysicsManager* _physics, double tickRate)
+{
+    physics = _physics;
+    tickDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / tickRate));
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.tickRate = tickRate;
+    }
+
+    stopping = false;
+    thread = std::thread(&SimulationThread::Loop, this);
+}
+
+void SimulationThread::Stop()
+{
+    if (!thread.joinable()) { return; }
+
+    stopping = true;
+    thread.join();
+}
+
+void SimulationThread::Loop()
+{
+    float dt = std::chrono::duration<float>(tickDuration).count();
+    std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
+
+    while (!stopping)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (!isRunning)
+        {
+            // Don't make up for the time spent stopped/paused
+            nextTick = now + tickDuration;
+            std::this_thread::sleep_until(nextTick);
+            continue;
+        }
+
+        int ticks = 0;
+        while (nextTick <= now && ticks < MAX_CATCH_UP_TICKS)
+        {
+            Tick(dt);
+            nextTick += tickDuration;
+            ++ticks;
+        }
+        if (nextTick <= now)
+        {
+            unsigned long long dropped = (now - nextTick) / tickDuration + 1;
+            nextTick += dropped * tickDuration;
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.droppedTicks += dropped;
+        }
+
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+void SimulationThread::Tick(float dt)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (std::function<void(float)>& handler : tickHandlers)
+    {
+        handler(dt);
+    }
+
+    TransformSnapshot& snapshot = snapshots.GetBack();
+    snapshot.tick = ++tickCount;
+    physics->Step(dt, snapshot.tick, interpolatedTick.load(), snapshot);
+    snapshot.time = std::chrono::steady_clock::now();
+    snapshots.Publish();
+
+    double tickMs = std::chrono::duration<double, std::milli>(snapshot.time - start).count();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.lastTickMs = tickMs;
+    stats.averageTickMs = stats.ticks == 0 ? tickMs : stats.averageTickMs * 0.95 + tickMs * 0.05;
+    ++stats.ticks;
+}
+
+void SimulationThread::Interpolate()
+{
+    if (physics == nullptr) { return; }
+
+    snapshots.Acquire();
+    const TransformSnapshot& snapshot = snapshots.GetFront();
+    // Nothing published yet, or its objects were removed since
+    if (snapshot.tick == 0 || snapshot.generation != physics->GetGeneration()) { return; }
+    interpolatedTick = snapshot.tick;
+
+    // The remainder of the accumulator: how far into the next tick the
+    // frame is. Rendering one tick behind lets it blend between two
+    // known states instead of extrapolating
+    float alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.time).count()
+                / std::chrono::duration<float>(tickDuration).count();
+    alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+
+    for (const TransformSnapshot::Entry& entry : snapshot.entries)
+    {
+        entry.object->SetPosition(glm::mix(entry.previousPosition, entry.position, alpha));
+        entry.object->SetRotation(glm::slerp(entry.previousRotation, entry.rotation, alpha));
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.alpha = alpha;
+}
+
+SimulationThread::Stats SimulationThread::GetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
@@ -0,0 +1,101 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TripleBuffer.h"
+
+class GlObject;
+class PhysicsManager;
+
+// Transforms of every moving body at the end of one simulation tick,
+// along with where they were at the start of it
+struct TransformSnapshot
+{
+    struct Entry
+    {
+        GlObject* object;
+        glm::vec3 previousPosition;
+        glm::vec3 position;
+        glm::quat previousRotation;
+        glm::quat rotation;
+    };
+
+    std::vector<Entry> entries;
+    unsigned long long tick = 0;
+    // PhysicsManager generation the entries belong to, objects of
+    // older generations may have been deleted since
+    unsigned int generation = 0;
+    std::chrono::steady_clock::time_point time;
+};
+
+// Steps physics and game logic at a fixed rate on its own thread,
+// independent of how fast frames are rendered. Every tick publishes a
+// TransformSnapshot, the main thread blends the newest one into the
+// objects with Interpolate
+class SimulationThread
+{
+public:
+    struct Stats
+    {
+        double tickRate = 0.0;
+        // Cost of one tick on the simulation thread
+        double lastTickMs = 0.0;
+        double averageTickMs = 0.0;
+        unsigned long long ticks = 0;
+        // Ticks skipped because the simulation couldn't keep up
+        unsigned long long droppedTicks = 0;
+        // Fraction of a tick the last Interpolate was past the snapshot
+        float alpha = 0.0f;
+    };
+
+    ~SimulationThread();
+
+    // Game logic run on the simulation thread before physics each tick,
+    // add them before Start
+    void AddTickHandler(std::function<void(float dt)> handler);
+
+    void Start(PhysicsManager* physics, double tickRate = 60.0);
+    void Stop();
+
+    // Ticks only happen while running, e.g. when the game is playing
+    void SetRunning(bool running) { isRunning = running; }
+
+    // Main thread, once per frame. Moves every simulated object to where
+    // it was the accumulated time since the last tick after the previous
+    // snapshot, so motion is smooth at any frame rate
+    void Interpolate();
+
+    Stats GetStats();
+
+private:
+    void Loop();
+    void Tick(float dt);
+
+    PhysicsManager* physics = nullptr;
+    std::vector<std::function<void(float)>> tickHandlers;
+
+    std::thread thread;
+    std::atomic<bool> stopping{ false };
+    std::atomic<bool> isRunning{ false };
+    std::chrono::steady_clock::duration tickDuration;
+
+    TripleBuffer<TransformSnapshot> snapshots;
+    unsigned long long tickCount = 0;
+    // Newest snapshot Interpolate has used. Snapshots only hold bodies
+    // that moved since, so ones skipped by the reader aren't missed
+    std::atomic<unsigned long long> interpolatedTick{ 0 };
+
+    std::mutex statsMutex;
+    Stats stats;
+};
+
+#endif // SIMULATION_THREAD_H
@@ -0,0 +1,154 @@
+#include "StartupGraph.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#include "rapidjson/writer.h"
+#include "rapidjson/filewritestream.h"
+
+StartupGraph::StartupGraph()
+{
+    origin = std::chrono::high_resolution_clock::now();
+}
+
+StartupGraph::~StartupGraph()
+{
+    Finish();
+}
+
+double StartupGraph::Now()
+{
+    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(now - origin).count();
+}
+
+void StartupGraph::Record(const std::string& name, int thread, double start, double end)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+    timeline.push_back({ name, thread, start, end });
+}
+
+StartupGraph::TaskId StartupGraph::Add(const std::string& name, std::function<void()> work,
+                                       const std::vector<TaskId>& dependencies)
+{
+    TaskId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = static_cast<TaskId>(tasks.size());
+        tasks.emplace_back();
+        tasks.back().name = name;
+    }
+
+    std::shared_ptr<std::function<void()>> recorded = std::make_shared<std::function<void()>>(
+        [this, name, work = std::move(work)]
+        {
+            double start = Now();
+            work();
+            Record(name, JobSystem::ThreadIndex(), start, Now());
+        });
+    Schedule(id, recorded, dependencies, 0);
+    return id;
+}
+
+void StartupGraph::Schedule(TaskId id, std::shared_ptr<std::function<void()>> work,
+                            std::vector<TaskId> dependencies, size_t next)
+{
+    JobCounter* done;
+    JobCounter* dependency = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = &tasks[id].done;
+        if (next < dependencies.size())
+        {
+            dependency = &tasks[dependencies[next]].done;
+        }
+    }
+
+    if (dependency == nullptr)
+    {
+        jobSystem.Run([work] { (*work)(); }, done);
+        return;
+    }
+    // The next link is queued before this one finishes, so done
+    // never drops to zero in between
+    jobSystem.RunAfter(*dependency, [this, id, work, dependencies, next]
+    {
+        Schedule(id, work, dependencies, next + 1);
+    }, done);
+}
+
+void StartupGraph::RecordMain(const std::string& name, double start)
+{
+    Record(name, 0, start, Now());
+}
+
+void StartupGraph::Wait(TaskId id)
+{
+    double start = Now();
+    JobCounter* done;
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = &tasks[id].done;
+        name = tasks[id].name;
+    }
+    jobSystem.Wait(*done);
+    Record("wait: " + name, 0, start, Now());
+}
+
+void StartupGraph::Finish()
+{
+    // Tasks may add more tasks, so check the size again after every wait
+    for (size_t i = 0; ; ++i)
+    {
+        JobCounter* done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (i >= tasks.size()) { return; }
+            done = &tasks[i].done;
+        }
+        jobSystem.Wait(*done);
+    }
+}
+
+std::vector<StartupGraph::TimelineEntry> StartupGraph::GetTimeline()
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+    return timeline;
+}
+
+bool StartupGraph::DumpTrace(const char* path)
+{
+    FILE* fp = fopen(path, "w");
+    if (fp == 0)
+    {
+        printf("ERROR: Failed to write startup trace: %s\n", path);
+        return false;
+    }
+
+    char writeBuffer[65536];
+    rapidjson::FileWriteStream os(fp, writeBuffer, sizeof(writeBuffer));
+    rapidjson::Writer<rapidjson::FileWriteStream> writer(os);
+
+    writer.StartObject();
+    writer.Key("traceEvents");
+    writer.StartArray();
+    for (const TimelineEntry& entry : GetTimeline())
+    {
+        // Complete events, times in microseconds
+        writer.StartObject();
+        writer.Key("name"); writer.String(entry.name.c_str());
+        writer.Key("ph");   writer.String("X");
+        writer.Key("pid");  writer.Int(0);
+        writer.Key("tid");  writer.Int(entry.thread);
+        writer.Key("ts");   writer.Double(entry.start * 1000.0);
+        writer.Key("dur");  writer.Double((entry.end - entry.start) * 1000.0);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    os.Flush();
+
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef STARTUP_GRAPH_H
+#define STARTUP_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <chrono>
+
+#include "JobSystem.h"
+
+// Runs startup work that doesn't need the GL context (file reads, image
+// decodes, scene parsing) on the JobSystem workers, while the main
+// thread keeps creating GL objects and waits only for the results it
+// needs next. Every task is recorded in a timeline for TentGui/traces
+class StartupGraph
+{
+public:
+    typedef int TaskId;
+
+    struct TimelineEntry
+    {
+        std::string name;
+        // 0 is the main thread, workers start at 1
+        int thread;
+        // Milliseconds since the graph was created
+        double start;
+        double end;
+    };
+
+    StartupGraph();
+    ~StartupGraph();
+
+    // Queues work for a worker once all dependencies are done.
+    // Safe to call from inside a running task
+    TaskId Add(const std::string& name, std::function<void()> work,
+               const std::vector<TaskId>& dependencies = {});
+
+    // Marks a section of main thread work for the timeline, e.g. the GL
+    // uploads consuming what the workers produced:
+    //     double start = startup.Now(); ...; startup.RecordMain("upload", start);
+    double Now();
+    void RecordMain(const std::string& name, double start);
+
+    // Runs other tasks on the main thread until the task is done,
+    // recorded as a wait
+    void Wait(TaskId task);
+    // Waits for every task, including ones added by other tasks.
+    // The timeline stays available afterwards
+    void Finish();
+
+    // Copy, since workers may still be appending
+    std::vector<TimelineEntry> GetTimeline();
+    int GetWorkerCount() { return jobSystem.GetThreadCount() - 1; }
+    // Chrome trace event format, open in chrome://tracing or Perfetto
+    bool DumpTrace(const char* path);
+
+private:
+    struct Task
+    {
+        std::string name;
+        // Covers the task from Add until its work has run
+        JobCounter done;
+    };
+
+    // Chains the task behind its dependencies one at a time, the last
+    // link runs the work
+    void Schedule(TaskId id, std::shared_ptr<std::function<void()>> work,
+                  std::vector<TaskId> dependencies, size_t next);
+    void Record(const std::string& name, int thread, double start, double end);
+
+    std::chrono::high_resolution_clock::time_point origin;
+
+    // Guards tasks, deque so references stay valid while tasks are added
+    std::mutex mutex;
+    std::deque<Task> tasks;
+
+    std::mutex timelineMutex;
+    std::vector<TimelineEntry> timeline;
+};
+
+#endif // STARTUP_GRAPH_H
@@ -7,6 +7,8 @@
 #include "SceneLoader.h"
 
 #include <vector>
+#include <algorithm>
+#include <memory>
 
 const int TAG_LENGTH = 32;
 
@@ -78,10 +80,14 @@ void TentGui::ShowFileBrowser()
         switch (fileAction)
         {
             case OPEN:
-                shared.sceneLoader->LoadScene(
-                    *shared.objectManager,
-                    selectedFilePath.c_str()
-                );
+                // Creates and deletes GL objects the render thread draws
+                shared.renderThread->RunSync([]
+                {
+                    shared.sceneLoader->LoadScene(
+                        *shared.objectManager,
+                        selectedFilePath.c_str()
+                    );
+                });
                 break;
 
             case SAVE:
@@ -92,9 +98,12 @@ void TentGui::ShowFileBrowser()
                 break;
 
             case LOAD_TEXTURE: // TODO
-                std::cout << "Loading new texture " << fileDialog.GetSelected().string() << '\n';
-                Texture newTexture(fileDialog.GetSelected().string().c_str());
-                selectedObject->texture = newTexture;
+                std::cout << "Loading new texture " << selectedFilePath << '\n';
+                shared.renderThread->RunSync([]
+                {
+                    Texture newTexture(selectedFilePath.c_str());
+                    selectedObject->texture = newTexture;
+                });
                 break;
         }
 
@@ -109,7 +118,10 @@ void TentGui::ShowMenuFile()
     if (ImGui::MenuItem("New"))
     {
         // Prompt user if they want to save file first before creating new scene
-        shared.sceneLoader->LoadNewScene(*(shared.objectManager));
+        shared.renderThread->RunSync([]
+        {
+            shared.sceneLoader->LoadNewScene(*(shared.objectManager));
+        });
     }
 
     // TODO allow hot keys
@@ -222,6 +234,7 @@ void TentGui::ShowMainMenuBar()
         if (ImGui::BeginMenu("Tools"))
         {
             ImGui::MenuItem("Metrics", NULL, &show_app_metrics);
+            ImGui::MenuItem("Startup Timeline", NULL, &show_app_startup_timeline);
             ImGui::MenuItem("Style Editor", NULL, &show_app_style_editor);
             ImGui::MenuItem("About Dear ImGui", NULL, &show_app_about);
             ImGui::EndMenu();
@@ -254,6 +267,9 @@ void TentGui::Init(GLFWwindow* window)
     // Setup Platform/Renderer bindings
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 450");
+    // Creates the font texture and program while this thread still
+    // has the context, the render thread only draws with them
+    ImGui_ImplOpenGL3_NewFrame();
     // Setup Dear ImGui style;
     ImGui::StyleColorsDark();
 
@@ -277,8 +293,36 @@ void TentGui::RenderGUI(ObjectManager& manager)
 {
     ShowMainMenuBar();
     ShowSceneHierarchy(*(shared.objectManager));
+}
+
+void TentGui::RecordDrawData(RenderCommandBuffer& frame)
+{
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    ImDrawData* drawData = ImGui::GetDrawData();
+
+    struct DrawDataCopy
+    {
+        ImDrawData drawData;
+        ImVector<ImDrawList*> lists;
+
+        ~DrawDataCopy()
+        {
+            for (ImDrawList* list : lists) { IM_DELETE(list); }
+        }
+    };
+
+    std::unique_ptr<DrawDataCopy> copy(new DrawDataCopy());
+    copy->drawData = *drawData;
+    for (int i = 0; i < drawData->CmdListsCount; ++i)
+    {
+        copy->lists.push_back(drawData->CmdLists[i]->CloneOutput());
+    }
+    copy->drawData.CmdLists = copy->lists.Data;
+
+    frame.Record([copy = std::move(copy)]
+    {
+        ImGui_ImplOpenGL3_RenderDrawData(&copy->drawData);
+    });
 }
 
 void TentGui::ShowRenderPasses(const std::vector<FrameBuffer>& renderPasses)
@@ -291,19 +335,22 @@ void TentGui::ShowRenderPasses(const std::vector<FrameBuffer>& renderPasses)
             ImGui::SetNextItemOpen(true, ImGuiCond_Once);
             if (ImGui::TreeNode((void*)(intptr_t)i, "%s", renderPasses[i].name))
             {
-                Texture objectTex = renderPasses[i].texture;
-                //float aspectRatio = (float)objectTex.width/objectTex.height;
-                //if (ImGui::GetWindowWidth() > ImGui::GetWindowHeight())
-                //{
-                //    // Scale texture with window
-                //    ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2(ImGui::GetWindowWidth(), ImGui::GetWindowWidth()/aspectRatio), ImVec2(0,1), ImVec2(1,0));
-                //}
-                //else
-                //{
-                //    ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2(ImGui::GetWindowHeight()*aspectRatio, ImGui::GetWindowHeight()), ImVec2(0,1), ImVec2(1,0));
-                //}
-
-                ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2((float)1600/4, (float)900/4), ImVec2(0,1), ImVec2(1,0));
+                // Show every color attachment (e.g. each G-buffer target)
+                for (const Texture& objectTex : renderPasses[i].colorAttachments)
+                {
+                    //float aspectRatio = (float)objectTex.width/objectTex.height;
+                    //if (ImGui::GetWindowWidth() > ImGui::GetWindowHeight())
+                    //{
+                    //    // Scale texture with window
+                    //    ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2(ImGui::GetWindowWidth(), ImGui::GetWindowWidth()/aspectRatio), ImVec2(0,1), ImVec2(1,0));
+                    //}
+                    //else
+                    //{
+                    //    ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2(ImGui::GetWindowHeight()*aspectRatio, ImGui::GetWindowHeight()), ImVec2(0,1), ImVec2(1,0));
+                    //}
+
+                    ImGui::Image((void*)(intptr_t)objectTex.ID, ImVec2((float)1600/4, (float)900/4), ImVec2(0,1), ImVec2(1,0));
+                }
 
                 ImGui::Separator();
                 ImGui::TreePop();
@@ -314,6 +361,236 @@ void TentGui::ShowRenderPasses(const std::vector<FrameBuffer>& renderPasses)
     ImGui::End();
 }
 
+void TentGui::ShowRenderSettings(RenderSettings& settings, const RenderStats& stats)
+{
+    ImGui::Begin("Render Settings");
+
+    int renderPath = static_cast<int>(settings.renderPath);
+    ImGui::RadioButton("Forward",  &renderPath, RENDER_PATH_FORWARD); ImGui::SameLine();
+    ImGui::RadioButton("Deferred", &renderPath, RENDER_PATH_DEFERRED);
+    ImGui::SameLine(); HelpMarker("Deferred shades opaque objects once per pixel from a G-buffer.\n"
+                                  "Lights and transparent objects are still drawn forward.");
+    settings.renderPath = static_cast<RenderPath>(renderPath);
+
+    ImGui::Checkbox("Depth Pre-pass", &settings.depthPrepass);
+    ImGui::SameLine(); HelpMarker("Opaque objects using alpha cutouts should be marked transparent,\n"
+                                  "the pre-pass does not discard their holes.");
+    ImGui::Text("Opaque fragments shaded: %llu", stats.opaqueSamples.load());
+
+    int transparency = static_cast<int>(settings.transparency);
+    ImGui::RadioButton("Sorted",       &transparency, TRANSPARENCY_SORTED); ImGui::SameLine();
+    ImGui::RadioButton("Weighted OIT", &transparency, TRANSPARENCY_WEIGHTED_OIT);
+    ImGui::SameLine(); HelpMarker("Weighted blended order-independent transparency.\n"
+                                  "Transparent objects can be drawn in any order.");
+    settings.transparency = static_cast<TransparencyMode>(transparency);
+
+    ImGui::Separator();
+
+    PostProcessSettings& post = settings.postProcess;
+    ImGui::Checkbox("Compute Post-process", &post.useCompute);
+    ImGui::SameLine(); HelpMarker("Runs post-processing as compute dispatches.\n"
+                                  "Unchecked falls back to a screen.frag variant.");
+    ImGui::Checkbox("Blur", &post.blur);
+    int edgeFilter = static_cast<int>(post.edgeFilter);
+    ImGui::RadioButton("No Edges", &edgeFilter, EDGE_NONE); ImGui::SameLine();
+    ImGui::RadioButton("Sobel",    &edgeFilter, EDGE_SOBEL); ImGui::SameLine();
+    ImGui::RadioButton("Outline",  &edgeFilter, EDGE_OUTLINE);
+    post.edgeFilter = static_cast<EdgeFilter>(edgeFilter);
+    ImGui::Checkbox("Grayscale", &post.grayscale); ImGui::SameLine();
+    ImGui::Checkbox("Invert", &post.invert);
+    if (post.useCompute)
+    {
+        ImGui::Checkbox("Half Resolution", &post.halfResolution);
+        ImGui::SameLine(); HelpMarker("Effects run at half size and are upsampled at the end.");
+        ImGui::Text("Dispatches: %d", stats.postProcessDispatches.load());
+    }
+
+    ImGui::Separator();
+
+    ImGui::Text("Shader variants compiled: %zu", stats.shaderVariants.load());
+    ImGui::Text("Shader rebuilds in flight: %zu", stats.pendingShaderBuilds.load());
+
+    ImGui::Separator();
+
+    ImGui::Checkbox("Pipelined Rendering", &settings.pipelinedRendering);
+    ImGui::SameLine(); HelpMarker("The render thread draws the previous frame while this one is recorded.\n"
+                                  "Unchecked waits for each frame, like a single thread would.");
+
+    ImGui::End();
+}
+
+void TentGui::ShowPhysicsSettings(PhysicsManager& physics)
+{
+    ImGui::Begin("Physics Settings");
+
+    PhysicsSettings settings = physics.GetSettings();
+    int threading = static_cast<int>(settings.threading);
+    ImGui::RadioButton("Single Threaded", &threading, PHYSICS_SINGLE_THREADED); ImGui::SameLine();
+    ImGui::RadioButton("Multithreaded",   &threading, PHYSICS_MULTITHREADED);
+    ImGui::SameLine(); HelpMarker("Multithreaded runs collision and island solving on the job system workers.");
+
+    int broadphase = static_cast<int>(settings.broadphase);
+    ImGui::RadioButton("Dbvt",       &broadphase, BROADPHASE_DBVT); ImGui::SameLine();
+    ImGui::RadioButton("Axis Sweep", &broadphase, BROADPHASE_AXIS_SWEEP);
+    ImGui::SameLine(); HelpMarker("Switching rebuilds the world, bodies keep their state.");
+
+    if (threading != settings.threading || broadphase != settings.broadphase)
+    {
+        settings.threading = static_cast<PhysicsThreading>(threading);
+        settings.broadphase = static_cast<PhysicsBroadphase>(broadphase);
+        physics.Configure(settings);
+    }
+
+    ImGui::Separator();
+
+    const char* threadingNames[] = { "Single", "Multi" };
+    const char* broadphaseNames[] = { "Dbvt", "Axis Sweep" };
+    PhysicsStats stats = physics.GetStats();
+    ImGui::Text("Bodies: %d, pairs: %d, manifolds: %d", stats.bodies, stats.overlappingPairs, stats.manifolds);
+    ImGui::Columns(3, "stepTimes");
+    ImGui::Text("Threading"); ImGui::NextColumn();
+    ImGui::Text("Broadphase"); ImGui::NextColumn();
+    ImGui::Text("Step (ms)"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (int t = 0; t < PHYSICS_THREADING_COUNT; ++t)
+    {
+        for (int b = 0; b < BROADPHASE_COUNT; ++b)
+        {
+            ImGui::Text("%s", threadingNames[t]); ImGui::NextColumn();
+            ImGui::Text("%s", broadphaseNames[b]); ImGui::NextColumn();
+            if (stats.steps[t][b] == 0)
+                ImGui::Text("-");
+            else
+                ImGui::Text("%.3f", stats.stepMs[t][b]);
+            ImGui::NextColumn();
+        }
+    }
+    ImGui::Columns(1);
+
+    if (ImGui::CollapsingHeader("Level of Detail"))
+    {
+        PhysicsLodSettings lod = physics.GetLodSettings();
+        bool changed = ImGui::Checkbox("Enabled", &lod.enabled);
+        ImGui::SameLine(); HelpMarker("Far tiers step less often, bodies beyond the last tier are put to sleep until the camera comes near or something hits them.");
+
+        const char* tierNames[] = { "Near", "Middle", "Far" };
+        for (int t = 0; t < PHYSICS_LOD_TIER_COUNT; ++t)
+        {
+            ImGui::PushID(t);
+            ImGui::Text("%s", tierNames[t]);
+            changed |= ImGui::DragFloat("Radius", &lod.tierRadius[t], 1.0f, 0.0f, 10000.0f);
+            changed |= ImGui::SliderInt("Tick Interval", &lod.tickInterval[t], 1, 8);
+            ImGui::PopID();
+        }
+        // Tiers are nested
+        for (int t = 1; t < PHYSICS_LOD_TIER_COUNT; ++t)
+        {
+            lod.tierRadius[t] = std::max(lod.tierRadius[t], lod.tierRadius[t - 1]);
+        }
+        if (changed)
+        {
+            physics.SetLodSettings(lod);
+        }
+
+        ImGui::Text("Awake: near %d, middle %d, far %d, beyond %d", stats.lod.awakeBodies[0],
+                    stats.lod.awakeBodies[1], stats.lod.awakeBodies[2], stats.lod.awakeBodies[3]);
+        ImGui::Text("Frozen last step: %d", stats.lod.frozenBodies);
+        ImGui::Text("Forced to sleep: %llu, woken: %llu", stats.lod.forcedSleeps, stats.lod.wakes);
+    }
+
+    if (ImGui::CollapsingHeader("Collision Layers"))
+    {
+        CollisionLayers layers = physics.GetCollisionLayers();
+        bool changed = false;
+
+        // Lower triangle of the symmetric matrix, one checkbox per pair
+        int count = layers.GetLayerCount();
+        ImGui::Columns(count + 1, "layerMatrix", false);
+        ImGui::NextColumn();
+        for (int b = 0; b < count; ++b)
+        {
+            ImGui::Text("%s", layers.GetName(b).c_str()); ImGui::NextColumn();
+        }
+        for (int a = 0; a < count; ++a)
+        {
+            ImGui::Text("%s", layers.GetName(a).c_str()); ImGui::NextColumn();
+            for (int b = 0; b < count; ++b)
+            {
+                if (b <= a)
+                {
+                    bool collides = layers.Collides(a, b);
+                    ImGui::PushID(a * MAX_COLLISION_LAYERS + b);
+                    if (ImGui::Checkbox("", &collides))
+                    {
+                        layers.SetCollides(a, b, collides);
+                        changed = true;
+                    }
+                    ImGui::PopID();
+                }
+                ImGui::NextColumn();
+            }
+        }
+        ImGui::Columns(1);
+
+        ImGui::InputText("##newLayer", newLayerName, IM_ARRAYSIZE(newLayerName));
+        ImGui::SameLine();
+        if (ImGui::Button("Add Layer") && newLayerName[0] != '\0' && layers.Find(newLayerName) < 0)
+        {
+            changed |= layers.Add(newLayerName) >= 0;
+            newLayerName[0] = '\0';
+        }
+        if (changed)
+        {
+            physics.SetCollisionLayers(layers);
+        }
+
+        ImGui::Text("New pairs tested: %llu", stats.pairsTested);
+        ImGui::Text("Rejected by layer: %llu, static pairs: %llu", stats.pairsRejectedByLayer, stats.pairsRejectedStatic);
+    }
+
+    if (ImGui::CollapsingHeader("Debug Drawing"))
+    {
+        unsigned int mode = physics.GetDebugDrawMode();
+        bool changed = false;
+        changed |= ImGui::CheckboxFlags("Shapes", &mode, btIDebugDraw::DBG_DrawWireframe);
+        changed |= ImGui::CheckboxFlags("AABBs", &mode, btIDebugDraw::DBG_DrawAabb);
+        changed |= ImGui::CheckboxFlags("Contacts", &mode, btIDebugDraw::DBG_DrawContactPoints);
+        changed |= ImGui::CheckboxFlags("Constraints", &mode, btIDebugDraw::DBG_DrawConstraints);
+        changed |= ImGui::CheckboxFlags("Constraint Limits", &mode, btIDebugDraw::DBG_DrawConstraintLimits);
+        if (changed)
+        {
+            physics.SetDebugDrawMode(mode);
+        }
+        ImGui::Text("Lines: %zu", stats.debugVertices / 2);
+        ImGui::SameLine(); HelpMarker("Drawn over the scene without depth testing, in one draw call.");
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Cooked collision: %d loaded, %d cooked", stats.cooking.hits, stats.cooking.misses);
+    ImGui::Text("Load %.2f ms, cooking %.2f ms", stats.cooking.loadMs, stats.cooking.cookMs);
+    ImGui::SameLine(); HelpMarker("Model collision is cooked once into " COLLISION_CACHE_DIR " and memory mapped on later loads.");
+
+    ImGui::Separator();
+    if (!stats.recording)
+    {
+        ImGui::InputText("Log File", physicsLogPath, IM_ARRAYSIZE(physicsLogPath));
+        if (ImGui::Button("Start Recording"))
+        {
+            physics.StartRecording(physicsLogPath);
+        }
+        ImGui::SameLine(); HelpMarker("Records the world and every tick after it, PhysicsReplay steps through it again headless. Switches to single threaded until it stops.");
+    }
+    else
+    {
+        ImGui::Text("Recording %s: %llu ticks, %.1f KB", physicsLogPath, stats.recordedTicks, stats.recordedBytes / 1024.0);
+        if (ImGui::Button("Stop Recording"))
+        {
+            physics.StopRecording();
+        }
+    }
+
+    ImGui::End();
+}
 
 void TentGui::ShowCamera(Camera& cam)
 {
@@ -365,7 +642,10 @@ void TentGui::ShowPrimitiveGenerator(ObjectManager& manager)
     if (tagString.empty()) { tagString = "<no tag>"; }
     if (ImGui::Button("Generate"))
     {
-        manager.LoadObject(selectedGeom, tagString, position, rotation, scale);
+        shared.renderThread->RunSync([&]
+        {
+            manager.LoadObject(selectedGeom, tagString, position, rotation, scale);
+        });
     }
 
     ImGui::End();
@@ -374,17 +654,15 @@ void TentGui::ShowPrimitiveGenerator(ObjectManager& manager)
 
 void TentGui::ShowObjects(ObjectManager& manager)
 {
-    static int selected = -1;
-
     ImGui::Text("Scene Objects");
     // TODO
     // Note: the number 105 was just chosen by eye
     // Eventually figure out a way that takes into account the button's width
     ImGui::SameLine(ImGui::GetWindowWidth()-105);
-    if (ImGui::Button("Remove Object") && selected != -1)
+    if (ImGui::Button("Remove Object") && selectedIndex != -1)
     {
-        manager.RemoveObject(selected);
-        selected = -1;
+        manager.RemoveObject(selectedIndex);
+        selectedIndex = -1;
     }
 
     ImGui::Separator();
@@ -400,32 +678,169 @@ void TentGui::ShowObjects(ObjectManager& manager)
 
     HelpMarker(filterHelp);
     ImGui::SameLine(); filter.Draw();
+    ImGui::SameLine(); HelpMarker("Left click an object in the viewport to select it.");
 
     ImGui::Separator();
 
-    int i = 0;
-    for (auto object : manager.glObjectList)
+    if (selectedIndex >= static_cast<int>(manager.glObjectList.size()))
+    {
+        selectedIndex = -1;
+    }
+
+    // Filtering is redone when the filter or the object count changes,
+    // renaming an object shows once either does
+    int count = static_cast<int>(manager.glObjectList.size());
+    bool filtered = filter.IsActive();
+    if (filtered && (filteredText != filter.InputBuf || filteredCount != manager.glObjectList.size()))
+    {
+        filteredText = filter.InputBuf;
+        filteredCount = manager.glObjectList.size();
+        filteredObjects.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            if (filter.PassFilter(manager.glObjectList[i]->name.c_str()))
+            {
+                filteredObjects.push_back(i);
+            }
+        }
+    }
+    int rows = filtered ? static_cast<int>(filteredObjects.size()) : count;
+
+    ImGui::BeginChild("Object List", ImVec2(0, ImGui::GetTextLineHeightWithSpacing() * 16));
+    if (scrollToSelected && selectedIndex != -1)
     {
-        if (filter.PassFilter(object->name.c_str()))
+        int row = selectedIndex;
+        if (filtered)
+        {
+            std::vector<int>::iterator found = std::lower_bound(filteredObjects.begin(), filteredObjects.end(), selectedIndex);
+            row = (found != filteredObjects.end() && *found == selectedIndex)
+                ? static_cast<int>(found - filteredObjects.begin()) : -1;
+        }
+        if (row != -1)
         {
+            ImGui::SetScrollY(row * ImGui::GetTextLineHeightWithSpacing());
+        }
+    }
+    scrollToSelected = false;
+
+    // Only the visible rows are formatted and submitted
+    ImGuiListClipper clipper(rows);
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+        {
+            int i = filtered ? filteredObjects[row] : row;
             char tag[TAG_LENGTH];
-            sprintf(tag, "Idx:%d Tag:%s", i, object->name.c_str());
-            //sprintf(tag, "%s", object->name.c_str()); // TODO, inspector breaks when not printing index?
-            if (ImGui::Selectable(tag, selected == i))
+            snprintf(tag, TAG_LENGTH, "Idx:%d Tag:%s", i, manager.glObjectList[i]->name.c_str());
+            if (ImGui::Selectable(tag, selectedIndex == i))
             {
-                selected = i;
+                selectedIndex = i;
             }
         }
-        ++i;
     }
+    ImGui::EndChild();
+
+    if (selectedIndex != -1)
+    {
+        ShowInspector(manager.glObjectList[selectedIndex]);
+    }
+}
+
+void TentGui::PickObject(ObjectManager& manager)
+{
+    // Clicks on windows or on the gizmo aren't meant for the scene
+    ImGuiIO& io = ImGui::GetIO();
+    if (!ImGui::IsMouseClicked(0) || io.WantCaptureMouse || ImGuizmo::IsOver() || ImGuizmo::IsUsing()) { return; }
+    if (io.DisplaySize.x <= 0.0f || io.DisplaySize.y <= 0.0f) { return; }
+
+    // From the near to the far plane under the cursor
+    glm::mat4 view = activeCamera->GetViewMatrix();
+    glm::mat4 proj = activeCamera->GetProjMatrix(io.DisplaySize.x, io.DisplaySize.y);
+    glm::mat4 inverse = glm::inverse(proj * view);
+    float x = io.MousePos.x / io.DisplaySize.x * 2.0f - 1.0f;
+    float y = 1.0f - io.MousePos.y / io.DisplaySize.y * 2.0f;
+    glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+
+    GlObject* picked = shared.physicsManager->Pick(glm::vec3(nearPoint) / nearPoint.w,
+                                                   glm::vec3(farPoint) / farPoint.w);
+
+    // Clicking empty space clears the selection
+    selectedIndex = -1;
+    if (picked != nullptr)
+    {
+        std::vector<GlObject*>::iterator found = std::find(manager.glObjectList.begin(), manager.glObjectList.end(), picked);
+        if (found != manager.glObjectList.end())
+        {
+            selectedIndex = static_cast<int>(found - manager.glObjectList.begin());
+            scrollToSelected = true;
+        }
+    }
+}
+
+void TentGui::ShowStartupTimeline(StartupGraph& startup)
+{
+    if (!show_app_startup_timeline) { return; }
+
+    ImGui::Begin("Startup Timeline", &show_app_startup_timeline);
+
+    std::vector<StartupGraph::TimelineEntry> timeline = startup.GetTimeline();
+    double totalTime = 0.0;
+    for (const StartupGraph::TimelineEntry& entry : timeline)
+    {
+        totalTime = std::max(totalTime, entry.end);
+    }
+    if (totalTime <= 0.0) { totalTime = 1.0; }
+
+    ImGui::Text("%.1f ms, %d workers", totalTime, startup.GetWorkerCount());
+    ImGui::SameLine();
+    if (ImGui::Button("Dump Trace"))
+    {
+        startup.DumpTrace("startup_trace.json");
+    }
+    ImGui::SameLine(); HelpMarker("Writes startup_trace.json, open it in chrome://tracing or Perfetto.");
+
+    // One row per thread, main thread on top
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float labelWidth = 60.0f;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(100.0f, ImGui::GetContentRegionAvail().x - labelWidth);
+    int rows = startup.GetWorkerCount() + 1;
 
-    if (selected != -1)
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    for (int row = 0; row < rows; ++row)
     {
-        ShowInspector(manager.glObjectList[selected]);
+        char label[32] = "main";
+        if (row > 0) { snprintf(label, sizeof(label), "worker %d", row); }
+        drawList->AddText(ImVec2(origin.x, origin.y + row * rowHeight), ImGui::GetColorU32(ImGuiCol_Text), label);
     }
+
+    for (const StartupGraph::TimelineEntry& entry : timeline)
+    {
+        float x0 = origin.x + labelWidth + static_cast<float>(entry.start / totalTime) * width;
+        float x1 = origin.x + labelWidth + static_cast<float>(entry.end / totalTime) * width;
+        float y0 = origin.y + entry.thread * rowHeight;
+        ImVec2 min(x0, y0 + 1.0f);
+        ImVec2 max(std::max(x1, x0 + 1.0f), y0 + rowHeight - 1.0f);
+
+        // Waits in red so stalls on the main thread stand out
+        bool isWait = entry.name.compare(0, 5, "wait:") == 0;
+        ImU32 color = isWait ? IM_COL32(200, 60, 60, 255) : IM_COL32(80, 140, 220, 255);
+        drawList->AddRectFilled(min, max, color);
+
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s\n%.2f ms (%.2f - %.2f)", entry.name.c_str(),
+                              entry.end - entry.start, entry.start, entry.end);
+        }
+    }
+    ImGui::Dummy(ImVec2(labelWidth + width, rows * rowHeight));
+
+    ImGui::End();
 }
 
-void TentGui::ShowMetrics(double frameTime)
+void TentGui::ShowMetrics(double frameTime, const SimulationThread::Stats& simStats,
+                          const RenderThread::Stats& renderStats)
 {
     if (!show_app_metrics) { return; }
 
@@ -434,6 +849,7 @@ void TentGui::ShowMetrics(double frameTime)
     ImGui::Checkbox("Animate", &animate);
 
     static float values[90] = {};
+    static float tickValues[90] = {};
     static int values_offset = 0;
     static double refresh_time = 0.0;
     if (!animate || refresh_time == 0.0)
@@ -442,6 +858,7 @@ void TentGui::ShowMetrics(double frameTime)
     while (refresh_time < ImGui::GetTime()) // Create dummy data at fixed 60 hz rate for the demo
     {
         values[values_offset] = frameTime*1000; // convert to milliseconds;
+        tickValues[values_offset] = simStats.lastTickMs;
         values_offset = (values_offset+1) % IM_ARRAYSIZE(values);
         refresh_time += 1.0f/60.0f;
     }
@@ -460,6 +877,27 @@ void TentGui::ShowMetrics(double frameTime)
         // TODO make the time scale adjustable? Either scale with the average or allow user to configure
         ImGui::PlotLines("Frame times", values, IM_ARRAYSIZE(values), values_offset, overlay, 0.0f, 20.0f, ImVec2(0,80));
     }
+
+    // Simulation thread, independent of the frame rate
+    {
+        ImGui::Text("Simulation: %.0f Hz, %llu ticks, %llu dropped", simStats.tickRate, simStats.ticks, simStats.droppedTicks);
+        ImGui::Text("Interpolation alpha: %.2f", simStats.alpha);
+        char overlay[32];
+        sprintf(overlay, "avg: %f ms", simStats.averageTickMs);
+        ImGui::PlotLines("Tick times", tickValues, IM_ARRAYSIZE(tickValues), values_offset, overlay, 0.0f, 1000.0f / std::max(simStats.tickRate, 1.0), ImVec2(0,80));
+    }
+
+    // Game thread records frame N while the render thread draws N-1
+    {
+        ImGui::Text("Game thread: %.2f ms recording, %.2f ms waiting", renderStats.gameMs, renderStats.gameWaitMs);
+        ImGui::Text("Render thread: %.2f ms drawing, %.2f ms swapping, %.2f ms waiting",
+                    renderStats.renderMs, renderStats.swapMs, renderStats.renderWaitMs);
+        ImGui::Text("Commands: %zu (%zu KB)", renderStats.commandCount, renderStats.commandBytes / 1024);
+
+        TransformSystem::Stats transformStats = transformSystem.GetStats();
+        ImGui::Text("Transforms: %zu, %zu rebuilt in %.3f ms", transformStats.transforms,
+                    transformStats.lastUpdated, transformStats.lastUpdateMs);
+    }
     ImGui::End();
 }
 
@@ -476,6 +914,8 @@ void EditTransform(GlObject* object, const float *cameraView, float *cameraProje
 
     // Create transform window in inspector
     ImGui::Begin("Inspector");
+    // The body couldn't follow, see PhysicsManager::MoveObject
+    bool recording = shared.physicsManager->GetStats().recording;
 
     ImGuiIO& io = ImGui::GetIO();
     // Note: numbers based on ascii table
@@ -496,12 +936,18 @@ void EditTransform(GlObject* object, const float *cameraView, float *cameraProje
     ImGui::SameLine();
     if (ImGui::RadioButton("Scale", mCurrentGizmoOperation == ImGuizmo::SCALE))
         mCurrentGizmoOperation = ImGuizmo::SCALE;
+    // Only written back when edited, the decompose round trip isn't exact
+    // and would mark the object's transform dirty every frame
+    bool edited = false;
     float matrixTranslation[3], matrixRotation[3], matrixScale[3];
     ImGuizmo::DecomposeMatrixToComponents(matrix, matrixTranslation, matrixRotation, matrixScale);
-    ImGui::InputFloat3("Tr", matrixTranslation, 3);
-    ImGui::InputFloat3("Rt", matrixRotation, 3);
-    ImGui::InputFloat3("Sc", matrixScale, 3);
-    ImGuizmo::RecomposeMatrixFromComponents(matrixTranslation, matrixRotation, matrixScale, matrix);
+    edited |= ImGui::InputFloat3("Tr", matrixTranslation, 3);
+    edited |= ImGui::InputFloat3("Rt", matrixRotation, 3);
+    edited |= ImGui::InputFloat3("Sc", matrixScale, 3);
+    if (edited)
+    {
+        ImGuizmo::RecomposeMatrixFromComponents(matrixTranslation, matrixRotation, matrixScale, matrix);
+    }
 
     if (mCurrentGizmoOperation != ImGuizmo::SCALE)
     {
@@ -539,17 +985,26 @@ void EditTransform(GlObject* object, const float *cameraView, float *cameraProje
         ImGui::PopID();
     }
     
-    ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
-    ImGuizmo::Manipulate(cameraView, cameraProjection, mCurrentGizmoOperation, mCurrentGizmoMode, matrix, NULL, useSnap ? &snap[0] : NULL, boundSizing?bounds:NULL, boundSizingSnap?boundsSnap:NULL);
+    if (recording)
+    {
+        ImGui::TextDisabled("Objects can't be moved while recording physics");
+    }
+    else
+    {
+        ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
+        ImGuizmo::Manipulate(cameraView, cameraProjection, mCurrentGizmoOperation, mCurrentGizmoMode, matrix, NULL, useSnap ? &snap[0] : NULL, boundSizing?bounds:NULL, boundSizingSnap?boundsSnap:NULL);
+        edited |= ImGuizmo::IsUsing();
+    }
 
     ImGui::Separator();
     ImGui::End();
 
     // Update GlObject transform
-    ImGuizmo::DecomposeMatrixToComponents(matrix, matrixTranslation, matrixRotation, matrixScale);
-    object->position = glm::make_vec3(matrixTranslation);
-    object->rotation = glm::make_vec3(matrixRotation);
-    object->scale    = glm::make_vec3(matrixScale);
+    if (edited && !recording)
+    {
+        object->SetModelMatrix(glm::make_mat4(matrix));
+        shared.physicsManager->MoveObject(object);
+    }
 }
 
 
@@ -573,11 +1028,12 @@ void TentGui::ShowInspector(GlObject* object)
     ImGui::Separator();
 
     { // Transform Info
-        float* matrix = const_cast<float*>(glm::value_ptr(object->GetModelMatrix()));
+        // A copy, the system's matrix only changes through the setters
+        glm::mat4 model = object->GetModelMatrix();
         float* view = const_cast<float*>(glm::value_ptr(activeCamera->GetViewMatrix()));
         float* proj = const_cast<float*>(glm::value_ptr(activeCamera->GetProjMatrix(1600, 900)));
 
-        EditTransform(object, view, proj, matrix);
+        EditTransform(object, view, proj, glm::value_ptr(model));
     }
 
     if (object->isLight)
@@ -603,6 +1059,22 @@ void TentGui::ShowInspector(GlObject* object)
     }
     else
     { // Mesh details
+        ImGui::Checkbox("Transparent", &object->isTransparent);
+
+        CollisionLayers layers = shared.physicsManager->GetCollisionLayers();
+        int layer = object->collisionLayer < layers.GetLayerCount() ? object->collisionLayer : 0;
+        if (ImGui::BeginCombo("Collision Layer", layers.GetName(layer).c_str()))
+        {
+            for (int i = 0; i < layers.GetLayerCount(); ++i)
+            {
+                if (ImGui::Selectable(layers.GetName(i).c_str(), i == layer))
+                {
+                    shared.physicsManager->SetObjectLayer(object, i);
+                }
+            }
+            ImGui::EndCombo();
+        }
+
         ImGui::SetNextItemOpen(true, ImGuiCond_Once);
         if (ImGui::TreeNode("Mesh Details"))
         {
@@ -649,6 +1121,8 @@ void TentGui::ShowSceneHierarchy(ObjectManager& manager)
 {
     ImGui::Begin("Scene Hierarchy");
 
+    PickObject(manager);
+
     ShowPrimitiveGenerator(*(shared.objectManager));
 
     ImGui::Separator();
@@ -12,7 +12,13 @@
 #include "Camera.h"
 #include "FrameBuffer.h"
 #include "Game.h"
+#include "RenderSettings.h"
+#include "StartupGraph.h"
+#include "SimulationThread.h"
+#include "RenderThread.h"
+#include "PhysicsManager.h"
 
+#include <string>
 #include <vector>
 
 class TentGui
@@ -22,6 +28,9 @@ public:
 
     void RenderStateButtons(GameController&);
     void RenderGUI(ObjectManager&);
+    // Ends the ImGui frame and records a copy of its draw data,
+    // ImGui reuses the original as soon as the next frame starts
+    void RecordDrawData(RenderCommandBuffer&);
 
     void ShowCamera(Camera&);
     // =================================
@@ -29,15 +38,20 @@ public:
     void ShowSceneHierarchy(ObjectManager&);
     void ShowPrimitiveGenerator(ObjectManager&);
     void ShowObjects(ObjectManager&);
+    // Selects the object under the cursor on a left click in the viewport
+    void PickObject(ObjectManager&);
     void ShowGizmo(GlObject*);
     void ShowInspector(GlObject*);
     void ShowRenderPasses(const std::vector<FrameBuffer>&);
+    void ShowRenderSettings(RenderSettings&, const RenderStats&);
+    void ShowPhysicsSettings(PhysicsManager&);
     // =================================
 
     void ShowMenuFile();
     void ShowFileBrowser();
     void ShowRenderPasses();
-    void ShowMetrics(double);
+    void ShowMetrics(double, const SimulationThread::Stats&, const RenderThread::Stats&);
+    void ShowStartupTimeline(StartupGraph&);
 
     bool isEnabled = 1;
 
@@ -61,8 +75,21 @@ private:
     bool show_app_custom_rendering = false;
 
     bool show_app_metrics = true;
+    bool show_app_startup_timeline = false;
     bool show_app_style_editor = false;
     bool show_app_about = false;
+
+    char physicsLogPath[256] = "physics.tplog";
+    char newLayerName[64] = "";
+
+    // Index into the ObjectManager's list, -1 if nothing is selected
+    int selectedIndex = -1;
+    // Set by picking, the list scrolls to the picked object
+    bool scrollToSelected = false;
+    // Rows of the object list while its filter is active
+    std::vector<int> filteredObjects;
+    std::string filteredText;
+    size_t filteredCount = 0;
 };
 
 #endif // TENT_GUI_H
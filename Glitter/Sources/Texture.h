@@ -2,6 +2,7 @@
 #define TEXTURE_H
 
 #include "stb_image.h"
+#include "ImageLoader.h"
 
 #include <glad/glad.h>
 
@@ -27,8 +28,12 @@ public:
         glGenTextures(1, &ID);
 
         //std::cout << path << std::endl;
-        int nrChannels;
-        unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
+        // Possibly decoded ahead of time on a worker thread
+        std::shared_ptr<const ImageData> image = ImageLoader::Get(texturePath);
+        int nrChannels = image->channels;
+        width = image->width;
+        height = image->height;
+        unsigned char *data = image->pixels;
         if (data)
         {
             GLenum format;
@@ -38,6 +43,7 @@ public:
                 format = GL_RGB;
             else if (nrChannels == 4)
                 format = GL_RGBA;
+            hasAlphaChannel = (nrChannels == 4);
 
             glBindTexture(GL_TEXTURE_2D, ID);
             glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
@@ -58,11 +64,10 @@ public:
         {
             std::cout << "ERROR: Failed to load " << path << std::endl;
         }
-
-        stbi_image_free(data);
     }
 
     std::string GetName() { return texturePath; }
+    bool HasAlphaChannel() const { return hasAlphaChannel; }
 
 private:
     std::string texturePath;
@@ -0,0 +1,271 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_SIMD 1
+#endif
+
+// Words of the dirty bitset per job, 1024 transforms
+static const size_t DIRTY_WORD_CHUNK = 16;
+// Smallest scale the normal matrix divides by, zero would give inf
+static const float MIN_SCALE = 1e-6f;
+
+uint32_t TransformSystem::Create()
+{
+    uint32_t id;
+    if (!freeIds.empty())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        if (used == positionX.size())
+        {
+            Grow();
+        }
+        id = used++;
+    }
+
+    // Free and new slots are already identity
+    worldMatrices[id] = glm::mat4(1.0f);
+    normalMatrices[id] = glm::mat4(1.0f);
+    ++stats.transforms;
+    return id;
+}
+
+void TransformSystem::Destroy(uint32_t id)
+{
+    positionX[id] = positionY[id] = positionZ[id] = 0.0f;
+    rotationX[id] = rotationY[id] = rotationZ[id] = 0.0f;
+    rotationW[id] = 1.0f;
+    scaleX[id] = scaleY[id] = scaleZ[id] = 1.0f;
+    dirty[id >> 6] &= ~(1ull << (id & 63));
+    freeIds.push_back(id);
+    --stats.transforms;
+}
+
+void TransformSystem::Grow()
+{
+    size_t capacity = positionX.empty() ? 256 : positionX.size() * 2;
+    positionX.resize(capacity, 0.0f);
+    positionY.resize(capacity, 0.0f);
+    positionZ.resize(capacity, 0.0f);
+    rotationX.resize(capacity, 0.0f);
+    rotationY.resize(capacity, 0.0f);
+    rotationZ.resize(capacity, 0.0f);
+    rotationW.resize(capacity, 1.0f);
+    scaleX.resize(capacity, 1.0f);
+    scaleY.resize(capacity, 1.0f);
+    scaleZ.resize(capacity, 1.0f);
+    worldMatrices.resize(capacity, glm::mat4(1.0f));
+    normalMatrices.resize(capacity, glm::mat4(1.0f));
+    dirty.resize(capacity / 64, 0);
+}
+
+void TransformSystem::SetPosition(uint32_t id, const glm::vec3& position)
+{
+    positionX[id] = position.x;
+    positionY[id] = position.y;
+    positionZ[id] = position.z;
+    MarkDirty(id);
+}
+
+void TransformSystem::SetRotation(uint32_t id, const glm::quat& rotation)
+{
+    glm::quat unit = glm::normalize(rotation);
+    rotationX[id] = unit.x;
+    rotationY[id] = unit.y;
+    rotationZ[id] = unit.z;
+    rotationW[id] = unit.w;
+    MarkDirty(id);
+}
+
+void TransformSystem::SetScale(uint32_t id, const glm::vec3& scale)
+{
+    scaleX[id] = scale.x;
+    scaleY[id] = scale.y;
+    scaleZ[id] = scale.z;
+    MarkDirty(id);
+}
+
+void TransformSystem::SetMatrix(uint32_t id, const glm::mat4& matrix)
+{
+    glm::vec3 axes[3];
+    glm::vec3 scale;
+    bool flat = false;
+    for (int i = 0; i < 3; ++i)
+    {
+        axes[i] = glm::vec3(matrix[i]);
+        scale[i] = glm::length(axes[i]);
+        if (scale[i] < MIN_SCALE)
+        {
+            flat = true;
+            continue;
+        }
+        axes[i] = axes[i] / scale[i];
+    }
+    SetPosition(id, glm::vec3(matrix[3]));
+    // A zero axis has no direction, keep the rotation as it was
+    if (flat)
+    {
+        SetScale(id, scale);
+        return;
+    }
+
+    // A mirrored basis can't be a rotation, flip one axis into the scale
+    if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f)
+    {
+        scale.x = -scale.x;
+        axes[0] = -axes[0];
+    }
+
+    glm::mat3 rotation;
+    rotation[0] = axes[0];
+    rotation[1] = axes[1];
+    rotation[2] = axes[2];
+    SetRotation(id, glm::quat_cast(rotation));
+    SetScale(id, scale);
+}
+
+// ===================================================================
+// Matrix builds. With q the unit rotation, column i of the world
+// matrix is column i of q's rotation matrix times scale i, and the
+// normal matrix divides by the scale instead, clamped away from zero
+#ifdef TRANSFORM_SIMD
+void TransformSystem::UpdateBatch(uint32_t first)
+{
+    // Lane k of each register belongs to transform first + k
+    __m128 x = _mm_loadu_ps(&rotationX[first]);
+    __m128 y = _mm_loadu_ps(&rotationY[first]);
+    __m128 z = _mm_loadu_ps(&rotationZ[first]);
+    __m128 w = _mm_loadu_ps(&rotationW[first]);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 signBit = _mm_set1_ps(-0.0f);
+    __m128 minScale = _mm_set1_ps(MIN_SCALE);
+
+    __m128 x2 = _mm_mul_ps(x, two);
+    __m128 y2 = _mm_mul_ps(y, two);
+    __m128 z2 = _mm_mul_ps(z, two);
+    __m128 xx = _mm_mul_ps(x, x2);
+    __m128 yy = _mm_mul_ps(y, y2);
+    __m128 zz = _mm_mul_ps(z, z2);
+    __m128 xy = _mm_mul_ps(x, y2);
+    __m128 xz = _mm_mul_ps(x, z2);
+    __m128 yz = _mm_mul_ps(y, z2);
+    __m128 wx = _mm_mul_ps(w, x2);
+    __m128 wy = _mm_mul_ps(w, y2);
+    __m128 wz = _mm_mul_ps(w, z2);
+
+    // rotation[column][row]
+    __m128 rotation[3][3] = {
+        { _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy) },
+        { _mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx) },
+        { _mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)) }
+    };
+    __m128 scale[3] = {
+        _mm_loadu_ps(&scaleX[first]),
+        _mm_loadu_ps(&scaleY[first]),
+        _mm_loadu_ps(&scaleZ[first])
+    };
+
+    for (int column = 0; column < 4; ++column)
+    {
+        __m128 world[4];
+        __m128 normal[4];
+        if (column < 3)
+        {
+            // max(|scale|, MIN_SCALE) with scale's sign put back
+            __m128 magnitude = _mm_max_ps(_mm_andnot_ps(signBit, scale[column]), minScale);
+            __m128 divisor = _mm_or_ps(magnitude, _mm_and_ps(signBit, scale[column]));
+            __m128 inverseScale = _mm_div_ps(one, divisor);
+            for (int row = 0; row < 3; ++row)
+            {
+                world[row] = _mm_mul_ps(rotation[column][row], scale[column]);
+                normal[row] = _mm_mul_ps(rotation[column][row], inverseScale);
+            }
+            world[3] = zero;
+            normal[3] = zero;
+        }
+        else
+        {
+            world[0] = _mm_loadu_ps(&positionX[first]);
+            world[1] = _mm_loadu_ps(&positionY[first]);
+            world[2] = _mm_loadu_ps(&positionZ[first]);
+            world[3] = one;
+            normal[0] = normal[1] = normal[2] = zero;
+            normal[3] = one;
+        }
+
+        // Rows across transforms into one column per transform
+        _MM_TRANSPOSE4_PS(world[0], world[1], world[2], world[3]);
+        _MM_TRANSPOSE4_PS(normal[0], normal[1], normal[2], normal[3]);
+        for (int k = 0; k < 4; ++k)
+        {
+            _mm_storeu_ps(glm::value_ptr(worldMatrices[first + k]) + column * 4, world[k]);
+            _mm_storeu_ps(glm::value_ptr(normalMatrices[first + k]) + column * 4, normal[k]);
+        }
+    }
+}
+#else
+void TransformSystem::UpdateBatch(uint32_t first)
+{
+    for (uint32_t id = first; id < first + 4; ++id)
+    {
+        glm::mat3 rotation = glm::mat3_cast(GetRotation(id));
+        glm::vec3 scale = GetScale(id);
+        glm::mat4& world = worldMatrices[id];
+        glm::mat4& normal = normalMatrices[id];
+        for (int column = 0; column < 3; ++column)
+        {
+            world[column] = glm::vec4(rotation[column] * scale[column], 0.0f);
+            float divisor = std::copysign(std::max(std::abs(scale[column]), MIN_SCALE), scale[column]);
+            normal[column] = glm::vec4(rotation[column] / divisor, 0.0f);
+        }
+        world[3] = glm::vec4(GetPosition(id), 1.0f);
+        normal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+#endif
+
+void TransformSystem::Update()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Each job owns whole words, so its bits and matrices are its own
+    std::atomic<size_t> batches{ 0 };
+    jobSystem.ParallelFor(dirty.size(), DIRTY_WORD_CHUNK, [&](size_t begin, size_t end)
+    {
+        size_t localBatches = 0;
+        for (size_t word = begin; word < end; ++word)
+        {
+            uint64_t bits = dirty[word];
+            if (bits == 0) { continue; }
+            dirty[word] = 0;
+
+            uint32_t base = static_cast<uint32_t>(word * 64);
+            for (uint32_t offset = 0; offset < 64; offset += 4)
+            {
+                if (((bits >> offset) & 0xF) != 0)
+                {
+                    UpdateBatch(base + offset);
+                    ++localBatches;
+                }
+            }
+        }
+        batches += localBatches;
+    });
+
+    stats.lastUpdated = batches * 4;
+    stats.lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
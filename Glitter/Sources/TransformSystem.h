@@ -0,0 +1,89 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class TransformSystem;
+extern TransformSystem transformSystem;
+
+// Position, rotation and scale of every object, one array per float so
+// matrices are built for four transforms at a time with SSE. Setters
+// only flag the transform in a dirty bitset. Update rebuilds the
+// matrices of flagged transforms and skips whole words of clean ones,
+// so objects that don't move cost nothing per frame. Game thread only
+class TransformSystem
+{
+public:
+    struct Stats
+    {
+        size_t transforms = 0;
+        // Rebuilt by the last Update, rounded up to whole batches of 4
+        size_t lastUpdated = 0;
+        double lastUpdateMs = 0.0;
+    };
+
+    // An identity transform, its matrices are valid right away
+    uint32_t Create();
+    void Destroy(uint32_t id);
+
+    glm::vec3 GetPosition(uint32_t id) const
+    {
+        return glm::vec3(positionX[id], positionY[id], positionZ[id]);
+    }
+    glm::quat GetRotation(uint32_t id) const
+    {
+        return glm::quat(rotationW[id], rotationX[id], rotationY[id], rotationZ[id]);
+    }
+    glm::vec3 GetScale(uint32_t id) const
+    {
+        return glm::vec3(scaleX[id], scaleY[id], scaleZ[id]);
+    }
+
+    void SetPosition(uint32_t id, const glm::vec3& position);
+    // Normalized here, the matrix build relies on it
+    void SetRotation(uint32_t id, const glm::quat& rotation);
+    void SetScale(uint32_t id, const glm::vec3& scale);
+    // Splits a translate * rotate * scale matrix, e.g. from a gizmo
+    void SetMatrix(uint32_t id, const glm::mat4& matrix);
+
+    // Rebuilds the matrices of every transform changed since the last
+    // call, split over the JobSystem when there are many
+    void Update();
+
+    // translate * rotate * scale, as of the last Update
+    const glm::mat4& GetWorldMatrix(uint32_t id) const { return worldMatrices[id]; }
+    // Inverse transpose of the world matrix's upper 3x3, which is
+    // rotate / scale. In a mat4 so batches store whole columns
+    const glm::mat4& GetNormalMatrix(uint32_t id) const { return normalMatrices[id]; }
+
+    Stats GetStats() const { return stats; }
+
+private:
+    void MarkDirty(uint32_t id) { dirty[id >> 6] |= 1ull << (id & 63); }
+    void Grow();
+    // Matrices of transforms first to first + 3
+    void UpdateBatch(uint32_t first);
+
+    // Capacity is a multiple of 64, so every dirty word is complete
+    // and every batch of 4 is in range. Free slots hold an identity
+    // transform, batches may include them
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<glm::mat4> normalMatrices;
+    // One bit per transform
+    std::vector<uint64_t> dirty;
+
+    // Slots handed out so far, freed ones included
+    uint32_t used = 0;
+    std::vector<uint32_t> freeIds;
+
+    Stats stats;
+};
+
+#endif // TRANSFORM_SYSTEM_H
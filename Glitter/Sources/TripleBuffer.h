@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest value from one writer thread to one reader thread
+// without either of them ever waiting. The writer fills GetBack() and
+// Publishes it, the reader calls Acquire() and reads GetFront(). Values
+// published while the reader is busy replace each other, so the reader
+// always sees the newest one
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side
+    T& GetBack() { return buffers[back]; }
+    void Publish()
+    {
+        back = middle.exchange(back | FRESH_BIT) & INDEX_MASK;
+    }
+
+    // Reader side, returns false (and keeps the old front) if nothing
+    // new has been published since the last call
+    bool Acquire()
+    {
+        if ((middle.load() & FRESH_BIT) == 0) { return false; }
+        front = middle.exchange(front) & INDEX_MASK;
+        return true;
+    }
+    T& GetFront() { return buffers[front]; }
+
+private:
+    static const int INDEX_MASK = 3;
+    static const int FRESH_BIT = 4;
+
+    T buffers[3];
+    // Owned by the writer
+    int back = 0;
+    // Index of the buffer in between, plus FRESH_BIT when it holds a
+    // value the reader hasn't taken yet
+    std::atomic<int> middle{ 1 };
+    // Owned by the reader
+    int front = 2;
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -34,12 +34,23 @@
 #include "Cubemap.h"
 #include "SceneLoader.h"
 #include "Model.h"
+#include "RenderSettings.h"
+#include "PostProcessChain.h"
+#include "DebugLineRenderer.h"
+#include "ProgramCache.h"
+#include "StartupGraph.h"
+#include "JobSystem.h"
+#include "SimulationThread.h"
+#include "RenderThread.h"
+#include "ImageLoader.h"
 #include "Shared.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+void BeginDepthPrepass(const DrawList& opaque, Shader* depthShader);
+void EndDepthPrepass();
 
 // settings
 const unsigned int SCR_WIDTH = 1600;
@@ -63,6 +74,9 @@ float lastFrame = 0.0f;
 GLuint VAO;
 GLuint uboLights;
 
+// Before objectManager, its objects give their transforms back
+// when it's destroyed
+TransformSystem transformSystem;
 ObjectManager objectManager;
 // TODO move to resource manager
 std::vector<FrameBuffer> renderPasses;
@@ -74,12 +88,70 @@ ShaderController shaderController;
 
 TentGui tentGui;
 
+RenderSettings renderSettings;
+RenderStats renderStats;
+
 GameController GAME;
 
+JobSystem jobSystem;
+RenderThread renderThread;
+
+// Set by the R key, handled at the start of the next recorded frame
+bool reloadShadersRequested = false;
+
 Shared shared;
 
 int main(int argc, char * argv[])
 {
+    // ===================================================================
+    // Startup work that doesn't need the GL context (image decodes, scene
+    // parsing) runs on workers while the main thread creates the window
+    // and builds shaders. The GL objects are created from the results
+    // further down, each waiting only for what it uses
+    jobSystem.Init();
+    shared.jobSystem = &jobSystem;
+    StartupGraph startup;
+    shared.sceneLoader = new SceneLoader();
+
+    //const char* scenePath = "Scenes/main.json";
+    const char* scenePath = "Scenes/blending.json";
+
+    std::vector<std::string> faces =
+    {
+        "Textures/skybox/right.jpg",
+        "Textures/skybox/left.jpg",
+        "Textures/skybox/up.jpg",
+        "Textures/skybox/down.jpg",
+        "Textures/skybox/front.jpg",
+        "Textures/skybox/back.jpg"
+    };
+
+    auto decodeImage = [&startup](const std::string& path)
+    {
+        if (ImageLoader::Reserve(path))
+        {
+            startup.Add("decode " + path, [path] { ImageLoader::Decode(path); });
+        }
+    };
+    decodeImage("Textures/wall.jpg");
+    decodeImage("Textures/uv.png");
+    for (const std::string& face : faces)
+    {
+        decodeImage(face);
+    }
+    // The scene's textures are only known once it's parsed
+    StartupGraph::TaskId sceneParse = startup.Add(std::string("parse ") + scenePath, [&]
+    {
+        if (shared.sceneLoader->ParseScene(scenePath))
+        {
+            for (const std::string& texture : shared.sceneLoader->GetSceneTextures())
+            {
+                decodeImage(texture);
+            }
+        }
+    });
+
+    double windowStart = startup.Now();
     // Load GLFW and Create a Window
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -103,43 +175,56 @@ int main(int argc, char * argv[])
 
     gladLoadGL();
     fprintf(stderr, "OpenGL %s\n", glGetString(GL_VERSION));
+    startup.RecordMain("create window", windowStart);
 
     // Initialize imgui context
     tentGui.Init(mWindow);
     tentGui.activeCamera = &camera;
 
     // use our shader program when we want to render an object
+    // All of these are compiled together, see Shader::BeginBatch
+    double shaderStart = startup.Now();
+    Shader::BeginBatch();
     Shader genericShader("../Glitter/Shaders/generic.vert", "../Glitter/Shaders/generic.frag");
     Shader lightShader("../Glitter/Shaders/light.vert", "../Glitter/Shaders/light.frag");
-    Shader screenShader("../Glitter/Shaders/postProcess.vert", "../Glitter/Shaders/kernel.frag");
+    Shader screenShader("../Glitter/Shaders/postProcess.vert", "../Glitter/Shaders/screen.frag");
+    Shader gBufferShader("../Glitter/Shaders/generic.vert", "../Glitter/Shaders/gBuffer.frag");
+    Shader deferredLightShader("../Glitter/Shaders/postProcess.vert", "../Glitter/Shaders/deferredLight.frag");
+    // Position-only program for the depth pre-pass. standard.vert computes
+    // gl_Position exactly like generic.vert so the main pass can use GL_EQUAL
+    Shader depthPrepassShader("../Glitter/Shaders/standard.vert", "../Glitter/Shaders/simpleDepth.frag");
+    Shader oitAccumShader("../Glitter/Shaders/generic.vert", "../Glitter/Shaders/oitAccum.frag");
+    Shader oitCompositeShader("../Glitter/Shaders/postProcess.vert", "../Glitter/Shaders/oitComposite.frag");
+    Shader skyboxShader("../Glitter/Shaders/skybox.vert", "../Glitter/Shaders/skybox.frag");
+    Shader::EndBatch();
+    startup.RecordMain("compile shaders", shaderStart);
     // Add shader to shaderController for hot reloading
     // TODO handle this seamlessly so that theres no need to add shader each time to controller
     shaderController.Add("generic", &genericShader);
     shaderController.Add("light", &lightShader);
     shaderController.Add("screen", &screenShader);
-
+    shaderController.Add("gBuffer", &gBufferShader);
+    shaderController.Add("deferredLight", &deferredLightShader);
+    shaderController.Add("depthPrepass", &depthPrepassShader);
+    shaderController.Add("oitAccum", &oitAccumShader);
+    shaderController.Add("oitComposite", &oitCompositeShader);
+
+    // Programs reading a file under Shaders/ are rebuilt when it's saved
+    shaderController.Watch("../Glitter/Shaders");
     shared.shaderController = &shaderController;
+    shared.renderSettings = &renderSettings;
     shared.objectManager = &objectManager;
-    shared.sceneLoader = new SceneLoader();
 
     // ===================================================================
     // Setup for textures
     //
+    // Waits for the decodes queued at the top of main if still running
+    double textureStart = startup.Now();
     Texture tex1("Textures/wall.jpg");
     Texture tex2("Textures/uv.png");
 
-    std::vector<std::string> faces =
-    {
-        "Textures/skybox/right.jpg",
-        "Textures/skybox/left.jpg",
-        "Textures/skybox/up.jpg",
-        "Textures/skybox/down.jpg",
-        "Textures/skybox/front.jpg",
-        "Textures/skybox/back.jpg"
-    };
-
     Cubemap skyboxTexture(faces);
-    Shader skyboxShader("../Glitter/Shaders/skybox.vert", "../Glitter/Shaders/skybox.frag");
+    startup.RecordMain("upload textures", textureStart);
     Cube skybox;
     skybox.shader = &skyboxShader;
     // ===================================================================
@@ -147,6 +232,10 @@ int main(int argc, char * argv[])
     Quad screenQuad;
     screenQuad.shader = &screenShader;
 
+    // Fullscreen quad for the deferred lighting pass
+    Quad lightingQuad;
+    lightingQuad.shader = &deferredLightShader;
+
     // ===================================================================
     // Bind UBO block index to shaders
     // TODO handle this by ShaderController
@@ -198,21 +287,65 @@ int main(int argc, char * argv[])
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
+    // Blending is only enabled around transparent objects
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // Counts fragments shaded by the opaque pass, to measure overdraw
+    GLuint opaqueSamplesQuery;
+    glGenQueries(1, &opaqueSamplesQuery);
+    bool opaqueSamplesQueried = false;
+
     // Framebuffer for normal color output
     FrameBuffer colorFB("Color Pass", SCR_WIDTH, SCR_HEIGHT);
-    FrameBuffer postprocessFB("Post Process Pass", SCR_WIDTH, SCR_HEIGHT);
+    // RGBA8 so the compute post-process chain can store into it
+    FrameBuffer postprocessFB("Post Process Pass", SCR_WIDTH, SCR_HEIGHT, { GL_RGBA8 });
+    // G-buffer for the deferred path: albedo, normal, and a sampled depth
+    // texture used to rebuild world positions in the lighting pass
+    FrameBuffer gBufferFB("G-Buffer Pass", SCR_WIDTH, SCR_HEIGHT, { GL_RGBA8, GL_RGB16F }, true);
+    // Weighted blended OIT targets: premultiplied color * weight
+    // and revealage, depth tested against the color pass
+    FrameBuffer oitFB("OIT Pass", SCR_WIDTH, SCR_HEIGHT, { GL_RGBA16F, GL_R8 });
+    oitFB.ShareDepth(colorFB);
+    renderPasses.push_back(gBufferFB);
     renderPasses.push_back(colorFB);
+    renderPasses.push_back(oitFB);
     renderPasses.push_back(postprocessFB);
 
+    PostProcessChain postProcessChain;
+    postProcessChain.Init(SCR_WIDTH, SCR_HEIGHT);
+    shaderController.Add("blur", postProcessChain.blurShader);
+    shaderController.Add("edge", postProcessChain.edgeShader);
+    shaderController.Add("resample", postProcessChain.resampleShader);
+
+    DebugLineRenderer debugLineRenderer;
+    debugLineRenderer.Init();
+    shaderController.Add("debugLines", debugLineRenderer.shader);
+
+    // Every program above has been built, report what the binary cache saved
+    {
+        const ProgramCache::Stats& cacheStats = ProgramCache::stats;
+        fprintf(stderr, "Shader cache: %d hits loaded in %.1f ms (%.1f ms of compiling saved), %d misses compiled in %.1f ms\n",
+                cacheStats.hits, cacheStats.loadMs, cacheStats.compileMsAvoided - cacheStats.loadMs,
+                cacheStats.misses, cacheStats.compileMs);
+    }
+
     PhysicsManager physicsManager;
     physicsManager.Start();
     shared.physicsManager = &physicsManager;
 
-    //shared.sceneLoader->LoadScene(objectManager, "Scenes/main.json");
-    shared.sceneLoader->LoadScene(objectManager, "Scenes/blending.json");
+    startup.Wait(sceneParse);
+    double sceneStart = startup.Now();
+    shared.sceneLoader->LoadScene(objectManager, scenePath);
+    startup.RecordMain("build scene", sceneStart);
+
+    // Physics runs at its own fixed rate from here on
+    SimulationThread simulation;
+    simulation.Start(&physicsManager);
+
+    // Everything decoded has been uploaded by now
+    startup.Finish();
+    ImageLoader::Clear();
+    fprintf(stderr, "Startup took %.1f ms with %d workers\n", startup.Now(), startup.GetWorkerCount());
 
 //    Model nanosuit("Models/nanosuit/nanosuit.obj");
 //    nanosuit.shader = shaderController.Get("generic");
@@ -222,6 +355,17 @@ int main(int argc, char * argv[])
 
     // ===================================================================
     // Rendering Loop
+    //
+    // This thread stays the game thread: input, ImGui, interpolating the
+    // simulation and recording frame N, while the render thread owns the
+    // context from here on and draws frame N-1
+    renderThread.Start(mWindow);
+    shared.renderThread = &renderThread;
+    // The metrics window is built before the frame it's in is done
+    double lastFrameTime = 0.0;
+    // Physics LOD tiers are measured from the active camera
+    std::vector<glm::vec3> physicsFocus(1);
+
     while (glfwWindowShouldClose(mWindow) == false)
     {
         std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
@@ -231,6 +375,7 @@ int main(int argc, char * argv[])
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        glfwPollEvents();
         processInput(mWindow);
 
         // TODO
@@ -248,13 +393,11 @@ int main(int argc, char * argv[])
             view = camera.GetViewMatrix();
             proj = camera.GetProjMatrix((float)SCR_WIDTH, (float)SCR_HEIGHT);
         }
+        physicsFocus[0] = (GAME.state == PLAY || GAME.state == PAUSE) ? gameCamera.Position : camera.Position;
+        physicsManager.SetLodFocusPoints(physicsFocus);
 
-        // Send the view and projection matrices to the UBO
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view));
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(proj));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
+        // Widgets are built before anything is recorded, scene changes
+        // they make must not delete what this frame's lists point to
         if (tentGui.isEnabled)
         {
             ImGui_ImplOpenGL3_NewFrame();
@@ -263,103 +406,305 @@ int main(int argc, char * argv[])
             ImGuizmo::BeginFrame();
 
             ImGui::ShowDemoWindow();
-        }
-
-        // TODO Update physics of all rigidbodies
-        //if (GAME.state == PLAY)
-            //physicsManager.Update();
-
-
-        // Rendering step
 
-        // ===================================================================
-        { // First render pass
-            // Getting color of the scene
-            glBindFramebuffer(GL_FRAMEBUFFER, colorFB.ID);
-
-            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            // =====================================
-            //{ // Background
-            //    glDepthMask(GL_FALSE);
-            //    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture.ID);
-            //    skybox.shader->use();
-            //    glBindVertexArray(skybox.VAO);
-            //    glDrawArrays(GL_TRIANGLES, 0, 36);
-            //    glBindVertexArray(0);
-            //    glDepthMask(GL_TRUE);
-            //}
-
-            // Background Fill Color
-            glEnable(GL_DEPTH_TEST);
-
-            // Draw scene
-            objectManager.Draw();
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            tentGui.ShowMetrics(lastFrameTime, simulation.GetStats(), renderThread.GetStats());
+            tentGui.RenderStateButtons(GAME);
+            tentGui.ShowCamera(camera);
+            tentGui.ShowCamera(gameCamera);
+            tentGui.ShowRenderPasses(renderPasses);
+            tentGui.ShowRenderSettings(renderSettings, renderStats);
+            tentGui.ShowPhysicsSettings(physicsManager);
+            tentGui.ShowStartupTimeline(startup);
+            tentGui.RenderGUI(objectManager);
         }
 
-        // ===================================================================
-        // TODO: depth pass for shadowmaps
-        // second pass
-        // Get depth information for shadows
-//        {
-//            glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-//            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-//            glClear(GL_DEPTH_BUFFER_BIT);
-//            int i = 0;
-//            for (auto renderObject : objectManager.objectList)
-//            {
-//                renderObject->Draw(tex1, boxPositions[i]);
-//                ++i;
-//            }
-//            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-//            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-//        }
-
-        // ===================================================================
-        { // Final pass: post-process
-            screenQuad.texture = colorFB.texture;
-            glBindFramebuffer(GL_FRAMEBUFFER, postprocessFB.ID);
-
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            glDisable(GL_DEPTH_TEST);
-            screenQuad.Draw();
-
-            // TODO how to handle the need to
-            // still render to the default FB to
-            // show something on the screen?
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            glDisable(GL_DEPTH_TEST);
-            screenQuad.Draw();
+        // Physics ticks on the simulation thread, move the objects to
+        // where they are at this point between its last two ticks
+        simulation.SetRunning(GAME.state == PLAY);
+        if (GAME.state == PLAY)
+        {
+            simulation.Interpolate();
         }
 
-        // ===================================================================
+        // Waits if the render thread is still on frame N-2
+        RenderCommandBuffer& frame = renderThread.BeginFrame();
 
-        if (tentGui.isEnabled)
+        bool reload = reloadShadersRequested;
+        reloadShadersRequested = false;
+        frame.Record([reload]
         {
-            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> timeSpan = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+            if (reload) { shaderController.ReloadShaders(); }
+            shaderController.Update();
+            // GL work queued by jobs, e.g. uploads of what a worker loaded
+            jobSystem.RunGlThreadJobs();
+
+            renderStats.shaderVariants = shaderController.GetVariantCount();
+            renderStats.pendingShaderBuilds = shaderController.GetPendingBuildCount();
+        });
+
+        // Draw packets are prepared on every worker and merged here
+        glm::vec3 viewPos = (GAME.state == PLAY || GAME.state == PAUSE) ? gameCamera.Position : camera.Position;
+        FrameDrawLists lists;
+        objectManager.BuildDrawLists(frame, viewPos, renderSettings.transparency == TRANSPARENCY_SORTED, lists);
+
+        // Everything the passes read from the game thread is copied in
+        frame.Record([&, settings = renderSettings, view, proj, lists]
+        {
+            // Send the view and projection matrices to the UBO
+            glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view));
+            glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(proj));
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            // Rendering step
+
+            // Last frame's query result is ready by now
+            if (opaqueSamplesQueried)
+            {
+                GLuint64 samples;
+                glGetQueryObjectui64v(opaqueSamplesQuery, GL_QUERY_RESULT, &samples);
+                renderStats.opaqueSamples = samples;
+            }
+
+            // ===================================================================
+            if (settings.renderPath == RENDER_PATH_DEFERRED)
+            { // Geometry pass
+                // Write albedo/normal/depth of opaque objects only,
+                // lighting is evaluated once per visible pixel afterwards
+                glBindFramebuffer(GL_FRAMEBUFFER, gBufferFB.ID);
+
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                glEnable(GL_DEPTH_TEST);
+                if (settings.depthPrepass) { BeginDepthPrepass(lists.opaque, &depthPrepassShader); }
+
+                objectManager.UpdateLights(lists);
+                glBeginQuery(GL_SAMPLES_PASSED, opaqueSamplesQuery);
+                objectManager.DrawOpaque(lists.opaque, &gBufferShader);
+                if (settings.depthPrepass) { EndDepthPrepass(); }
+                // Not in the pre-pass, they test and write depth as usual
+                objectManager.DrawOpaque(lists.alphaTested, &gBufferShader);
+                glEndQuery(GL_SAMPLES_PASSED);
+                opaqueSamplesQueried = true;
+
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+
+            { // First render pass
+                // Getting color of the scene
+                glBindFramebuffer(GL_FRAMEBUFFER, colorFB.ID);
+
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                // =====================================
+                //{ // Background
+                //    glDepthMask(GL_FALSE);
+                //    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture.ID);
+                //    skybox.shader->use();
+                //    glBindVertexArray(skybox.VAO);
+                //    glDrawArrays(GL_TRIANGLES, 0, 36);
+                //    glBindVertexArray(0);
+                //    glDepthMask(GL_TRUE);
+                //}
+
+                if (settings.renderPath == RENDER_PATH_DEFERRED)
+                {
+                    // Lighting pass over the G-buffer
+                    glDisable(GL_DEPTH_TEST);
+                    deferredLightShader.use();
+
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, gBufferFB.colorAttachments[0].ID);
+                    deferredLightShader.setInt("gAlbedo", 0);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, gBufferFB.colorAttachments[1].ID);
+                    deferredLightShader.setInt("gNormal", 1);
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, gBufferFB.depthTexture.ID);
+                    deferredLightShader.setInt("gDepth", 2);
+                    glActiveTexture(GL_TEXTURE0);
+
+                    glm::mat4 invViewProj = glm::inverse(proj * view);
+                    deferredLightShader.setMat4("invViewProj", glm::value_ptr(invViewProj));
+
+                    glBindVertexArray(lightingQuad.VAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glBindVertexArray(0);
+
+                    // Copy depth so that forward objects are
+                    // occluded by the deferred geometry
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, gBufferFB.ID);
+                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorFB.ID);
+                    glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT,
+                            GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                    glBindFramebuffer(GL_FRAMEBUFFER, colorFB.ID);
+
+                    // Lights and transparent objects fall back to forward
+                    glEnable(GL_DEPTH_TEST);
+                }
+                else
+                {
+                    // Background Fill Color
+                    glEnable(GL_DEPTH_TEST);
+
+                    // Draw scene
+                    if (settings.depthPrepass) { BeginDepthPrepass(lists.opaque, &depthPrepassShader); }
+
+                    objectManager.UpdateLights(lists);
+                    glBeginQuery(GL_SAMPLES_PASSED, opaqueSamplesQuery);
+                    objectManager.DrawOpaque(lists.opaque);
+                    if (settings.depthPrepass) { EndDepthPrepass(); }
+                    // Not in the pre-pass, they test and write depth as usual
+                    objectManager.DrawOpaque(lists.alphaTested);
+                    glEndQuery(GL_SAMPLES_PASSED);
+                    opaqueSamplesQueried = true;
+                }
+
+                objectManager.DrawLights(lists.lights);
+
+                if (settings.transparency == TRANSPARENCY_SORTED)
+                {
+                    objectManager.DrawTransparent(lists.transparent);
+                }
+
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+
+            // ===================================================================
+            if (settings.transparency == TRANSPARENCY_WEIGHTED_OIT &&
+                !lists.transparent.empty())
+            { // Transparent pass: weighted blended OIT
+                // Every transparent fragment adds its weighted color to the
+                // accumulation target and multiplies the revealage target by
+                // (1 - alpha), so no sorting is needed
+                glBindFramebuffer(GL_FRAMEBUFFER, oitFB.ID);
+
+                const GLfloat clearAccum[]  = { 0.0f, 0.0f, 0.0f, 0.0f };
+                const GLfloat clearReveal[] = { 1.0f, 0.0f, 0.0f, 0.0f };
+                glClearBufferfv(GL_COLOR, 0, clearAccum);
+                glClearBufferfv(GL_COLOR, 1, clearReveal);
+
+                // Depth test against the opaque scene without writing to it
+                glEnable(GL_DEPTH_TEST);
+                glDepthMask(GL_FALSE);
+                glEnable(GL_BLEND);
+                glBlendFunci(0, GL_ONE, GL_ONE);
+                glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+                objectManager.DrawTransparentAccum(lists.transparent, &oitAccumShader);
+
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_TRUE);
+
+                // Composite: resolve the weighted average over the opaque color
+                glBindFramebuffer(GL_FRAMEBUFFER, colorFB.ID);
+                glDisable(GL_DEPTH_TEST);
+
+                oitCompositeShader.use();
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, oitFB.colorAttachments[0].ID);
+                oitCompositeShader.setInt("accumTex", 0);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, oitFB.colorAttachments[1].ID);
+                oitCompositeShader.setInt("revealTex", 1);
+                glActiveTexture(GL_TEXTURE0);
+
+                glBindVertexArray(screenQuad.VAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glBindVertexArray(0);
+
+                glDisable(GL_BLEND);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+
+            // ===================================================================
+            // TODO: depth pass for shadowmaps
+            // second pass
+            // Get depth information for shadows
+    //        {
+    //            glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+    //            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    //            glClear(GL_DEPTH_BUFFER_BIT);
+    //            int i = 0;
+    //            for (auto renderObject : objectManager.objectList)
+    //            {
+    //                renderObject->Draw(tex1, boxPositions[i]);
+    //                ++i;
+    //            }
+    //            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    //            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    //        }
+
+            // ===================================================================
+            { // Final pass: post-process
+                glDisable(GL_DEPTH_TEST);
+                if (settings.postProcess.useCompute)
+                {
+                    postProcessChain.Run(colorFB.texture.ID, postprocessFB.texture.ID, settings.postProcess);
+                    renderStats.postProcessDispatches = postProcessChain.lastDispatchCount;
+                }
+                else
+                {
+                    const PostProcessSettings& post = settings.postProcess;
+                    unsigned int features = SHADER_FEATURE_NONE;
+                    if (post.blur)                         { features |= SHADER_FEATURE_BLUR; }
+                    if (post.edgeFilter == EDGE_SOBEL)     { features |= SHADER_FEATURE_EDGE_SOBEL; }
+                    if (post.edgeFilter == EDGE_OUTLINE)   { features |= SHADER_FEATURE_EDGE_OUTLINE; }
+                    if (post.grayscale)                    { features |= SHADER_FEATURE_GRAYSCALE; }
+                    if (post.invert)                       { features |= SHADER_FEATURE_INVERT; }
+
+                    screenQuad.texture = colorFB.texture;
+                    glBindFramebuffer(GL_FRAMEBUFFER, postprocessFB.ID);
+
+                    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT);
+
+                    // Already in clip space, and objects aren't read on this thread
+                    screenQuad.DrawWith(shaderController.GetVariant(&screenShader, features), glm::mat4(1.0f));
+                }
+
+                // Show the result by copying it to the default FB
+                // instead of drawing the screen quad a second time
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, postprocessFB.ID);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, postprocessFB.width, postprocessFB.height,
+                                  0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+        });
+
+        // Physics debug lines over the finished image, below the GUI
+        if (physicsManager.GetDebugDrawMode() != 0)
+        {
+            const std::vector<DebugVertex>& lines = physicsManager.DrawDebug();
+            size_t count = lines.size();
+            DebugVertex* vertices = frame.AllocateArray<DebugVertex>(count);
+            std::copy(lines.begin(), lines.end(), vertices);
+            frame.Record([&, vertices, count]
+            {
+                debugLineRenderer.Draw(vertices, count);
+            });
+        }
 
-            tentGui.ShowMetrics(timeSpan.count());
-            tentGui.RenderStateButtons(GAME);
-            tentGui.ShowCamera(camera);
-            tentGui.ShowCamera(gameCamera);
-            tentGui.ShowRenderPasses(renderPasses);
-            tentGui.RenderGUI(objectManager);
+        if (tentGui.isEnabled)
+        {
+            tentGui.RecordDrawData(frame);
         }
 
-        // Flip Buffers and Draw
-        glfwSwapBuffers(mWindow);
-        glfwPollEvents();
+        // Swapped by the render thread once the frame is drawn
+        renderThread.Submit(renderSettings.pipelinedRendering);
+
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        lastFrameTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
 
     } // End render loop
 
+    // Everything below needs the context back on this thread
+    renderThread.Stop();
+
+    glDeleteQueries(1, &opaqueSamplesQuery);
+
     // Cleanup for imgui
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -371,13 +716,41 @@ int main(int argc, char * argv[])
         glDeleteFramebuffers(1, &framebuffers.ID);
     }
 
+    postProcessChain.Shutdown();
+    debugLineRenderer.Shutdown();
+    simulation.Stop();
     physicsManager.Shutdown();
+    // Workers may still hold GL jobs, run them before the context goes
+    jobSystem.Shutdown();
 
     glfwTerminate();
     return EXIT_SUCCESS;
 }
 
 
+// Fills the depth buffer with opaque geometry only, without cutouts since
+// the depth shader doesn't alpha test. Until EndDepthPrepass, draws only
+// pass for the front-most fragment of each pixel
+void BeginDepthPrepass(const DrawList& opaque, Shader* depthShader)
+{
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    depthShader->use();
+    objectManager.DrawDepth(opaque, depthShader);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+}
+
+void EndDepthPrepass()
+{
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
 void processInputOnce(GLFWwindow *window)
 {
 
@@ -435,7 +808,8 @@ void processInput(GLFWwindow *window)
         int newState = glfwGetKey(window, GLFW_KEY_R);
         if (newState == GLFW_PRESS && oldState == GLFW_RELEASE)
         {
-            shaderController.ReloadShaders();
+            // Programs are rebuilt on the render thread
+            reloadShadersRequested = true;
         }
         oldState = newState;
     }
@@ -458,7 +832,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    renderThread.RunSync([=] { glViewport(0, 0, width, height); });
 }
 
 // glfw: whenever the mouse moves, this callback is called